@@ -1,28 +1,53 @@
+// Settings understood by the configuration page, in the order they are sent
+var CONFIG_KEYS = ['ready', 'temp_unit',
+  'black', 'black_hide', 'green', 'green_hide', 'herbal', 'herbal_hide',
+  'mate', 'mate_hide', 'oolong', 'oolong_hide', 'puerh', 'puerh_hide',
+  'rooibos', 'rooibos_hide', 'white', 'white_hide', 'matcha', 'matcha_hide',
+  'animate'];
+
 Pebble.addEventListener('showConfiguration', function(e) {
-  // Show config page
-  Pebble.openURL('https://clach04.github.io/pebble-tea-ready/tea_config_0.8.html');
+  // Pass the current settings to the page through its query string
+  var config_data = JSON.parse(localStorage.getItem('config') || '{}');
+  var query = [];
+  for (var i = 0; i < CONFIG_KEYS.length; i++) {
+    if (config_data[CONFIG_KEYS[i]] !== undefined)
+      query.push(CONFIG_KEYS[i] + '=' + encodeURIComponent(config_data[CONFIG_KEYS[i]]));
+  }
+  
+  // Show the config page bundled by wscript, no network needed. The trailing
+  // comment hides anything appended to the URL, like the emulator's return_to
+  var html = CONFIG_PAGE_HTML.split('__TEA_QUERY__').join(query.join('&')) + '<!--';
+  Pebble.openURL('data:text/html;charset=utf-8,' + encodeURIComponent(html));
 });
 
 Pebble.addEventListener('webviewclosed', function(e) {
+  // Nothing to do if the page was cancelled
+  if (!e.response || e.response === 'cancel' || e.response === 'CANCELLED')
+    return;
+  
   // Decode and parse config data as JSON
   var config_data = JSON.parse(decodeURIComponent(e.response));
   
+  // Remember the settings to prefill the page next time
+  localStorage.setItem('config', JSON.stringify(config_data));
+  
   // Prepare AppMessage payload
   var dict = {
     'PERSIST_READY': config_data.ready,
     'PERSIST_TEMP_UNIT': config_data.temp_unit,
-    'PERSIST_TEA_BLACK': config_data.black * 60 * config_data.black_hide,
-    'PERSIST_TEA_GREEN': config_data.green * 60 * config_data.green_hide,
-    'PERSIST_TEA_HERBAL': config_data.herbal * 60 * config_data.herbal_hide,
-    'PERSIST_TEA_MATE': config_data.mate * 60 * config_data.mate_hide,
-    'PERSIST_TEA_OOLONG': config_data.oolong * 60 * config_data.oolong_hide,
-    'PERSIST_TEA_PUERH': config_data.puerh * 60 * config_data.puerh_hide,
-    'PERSIST_TEA_ROOIBOS': config_data.rooibos * 60 * config_data.rooibos_hide,
-    'PERSIST_TEA_WHITE': config_data.white * 60 * config_data.white_hide,
-    'PERSIST_TEA_MATCHA': config_data.matcha * 60 * config_data.matcha_hide
+    'PERSIST_TEA_BLACK': Math.round(config_data.black * 60) * config_data.black_hide,
+    'PERSIST_TEA_GREEN': Math.round(config_data.green * 60) * config_data.green_hide,
+    'PERSIST_TEA_HERBAL': Math.round(config_data.herbal * 60) * config_data.herbal_hide,
+    'PERSIST_TEA_MATE': Math.round(config_data.mate * 60) * config_data.mate_hide,
+    'PERSIST_TEA_OOLONG': Math.round(config_data.oolong * 60) * config_data.oolong_hide,
+    'PERSIST_TEA_PUERH': Math.round(config_data.puerh * 60) * config_data.puerh_hide,
+    'PERSIST_TEA_ROOIBOS': Math.round(config_data.rooibos * 60) * config_data.rooibos_hide,
+    'PERSIST_TEA_WHITE': Math.round(config_data.white * 60) * config_data.white_hide,
+    'PERSIST_TEA_MATCHA': Math.round(config_data.matcha * 60) * config_data.matcha_hide,
+    'PERSIST_ANIMATE': config_data.animate || 0
   };
   
-  // Send settings to Pebble watchapp
+  // Send settings to Pebble watchapp, which only stores what changed
   console.log('Sending configuration: ' + JSON.stringify(dict));
   Pebble.sendAppMessage(dict,
     function(){
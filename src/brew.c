@@ -0,0 +1,118 @@
+#include "brew.h"
+#include "countdown.h"
+#include "glance.h"
+#include "keys.h"
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+static void brew_send(uint8_t, uint16_t, uint16_t, uint16_t);
+static void brew_worker_handler(uint16_t, AppWorkerMessage*);
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+// Last mode the worker reported
+static uint8_t s_worker_mode = WORKER_MODE_IDLE;
+
+/********************/
+/*     MESSAGES     */
+/********************/
+
+static void brew_send(uint8_t type, uint16_t data0, uint16_t data1, uint16_t data2) {
+  AppWorkerMessage message = {
+    .data0 = data0,
+    .data1 = data1,
+    .data2 = data2
+  };
+  app_worker_send_message(type, &message);
+}
+
+// Render whatever the worker reports
+static void brew_worker_handler(uint16_t type, AppWorkerMessage *message) {
+  if(type != WORKER_BREW_STATE)
+    return;
+  
+  uint8_t count_mode = message->data0 & 0x0F;
+  uint8_t tea = (message->data0 >> 4) & 0x0F;
+  bool alert = (message->data0 & 0x100) != 0;
+  
+  // Nothing is brewing, free the background worker slot
+  if(count_mode == WORKER_MODE_IDLE) {
+    // Clear the launcher if the brew was cancelled, or if no wakeup owns it.
+    // A finished brew's glance expires by itself.
+    if(s_worker_mode < 2 || (s_worker_mode == WORKER_MODE_IDLE && !wakeup_query(persist_read_int(PERSIST_WAKEUP), NULL)))
+      glance_clear();
+    s_worker_mode = count_mode;
+    app_worker_kill();
+    return;
+  }
+  s_worker_mode = count_mode;
+  
+  // Keep the launcher in sync with the worker, cooling as fixed at brew start
+  glance_update(count_mode, time(NULL) + message->data2, count_mode == 0 ? persist_read_int(PERSIST_COOL_DELAY) : 0, tea);
+  
+  // Alert before displaying so the window offers to stop the vibration
+  if(alert) {
+    brew_send(WORKER_BREW_ACK, 0, 0, 0);
+    countdown_alert();
+  }
+  
+  countdown_display_state(count_mode, time(NULL) + message->data2, message->data1, tea);
+}
+
+/********************/
+/*      BREWS       */
+/********************/
+
+bool brew_worker_running() {
+  return app_worker_is_running();
+}
+
+// Hand a new brew over to the worker, it reports back once started.
+// Returns false if the worker cannot take it, e.g. while the user is asked
+// to replace another app's worker.
+bool brew_start(uint8_t tea, uint16_t steep_time, uint16_t cool_delay) {
+  persist_write_int(PERSIST_COOL_DELAY, cool_delay);
+  
+  if(brew_worker_running()) {
+    brew_send(WORKER_BREW_START, tea, steep_time, cool_delay);
+    return true;
+  }
+  
+  // Start the worker, it picks the brew up from storage even if the app
+  // has exited by then
+  AppWorkerMessage start = {
+    .data0 = tea,
+    .data1 = steep_time,
+    .data2 = cool_delay
+  };
+  persist_write_data(PERSIST_BREW_START, &start, sizeof(start));
+  if(app_worker_launch() != APP_WORKER_RESULT_SUCCESS) {
+    persist_delete(PERSIST_BREW_START);
+    return false;
+  }
+  return true;
+}
+
+void brew_cancel() {
+  brew_send(WORKER_BREW_CANCEL, 0, 0, 0);
+}
+
+/********************/
+/*  INIT & DEINIT   */
+/********************/
+
+void brew_init() {
+  app_worker_message_subscribe(brew_worker_handler);
+  
+  // Ask for the brew in progress, the worker only runs while brewing
+  if(brew_worker_running())
+    brew_send(WORKER_BREW_QUERY, 0, 0, 0);
+}
+
+void brew_deinit() {
+  app_worker_message_unsubscribe();
+}
\ No newline at end of file
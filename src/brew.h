@@ -0,0 +1,12 @@
+#pragma once
+#include <pebble.h>
+
+/********************/
+/*     FUNCTION     */
+/********************/
+
+void brew_init();
+void brew_deinit();
+bool brew_worker_running();
+bool brew_start(uint8_t, uint16_t, uint16_t);
+void brew_cancel();
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "countdown.h"
+#include "brew.h"
+#include "glance.h"
 #include "keys.h"
 #include "tea_cup.h"
 #include "menu.h"
+#include "power.h"
 
 /********************/
 /*  STATIC DECLARE  */
@@ -11,12 +14,23 @@ static void countdown_back_handler(ClickRecognizerRef, void*);
 static void countdown_cancel_handler(ClickRecognizerRef, void*);
 static void vibrate_cancel_handler(ClickRecognizerRef, void*);
 static void countdown_click_config_provider(void*);
+static void countdown_push_window();
 static void countdown_timer_handler(void*);
 static void countdown_update_layer(Layer*, GContext*);
 static void countdown_window_load(Window*);
 static void countdown_window_unload(Window*);
 static void wakeup_vibrate_handler(void*);
 static void completed_click_config_provider(void*);
+static void countdown_watch_handler(ClickRecognizerRef, void*);
+static void countdown_tap_handler(AccelAxisType, int32_t);
+static void countdown_watch_start();
+static void countdown_watch_timeout_handler(void*);
+static void fill_animation_start();
+static void fill_animation_stop();
+static void fill_animation_update(Animation*, const AnimationProgress);
+static void fill_animation_stopped(Animation*, bool, void*);
+static uint32_t countdown_now_ms();
+static uint16_t countdown_fill();
 
 /********************/
 /*    VARIABLES     */
@@ -29,60 +43,112 @@ static ActionBarLayer *s_action_bar_layer;
 static GBitmap *s_cross_bitmap;
 static GBitmap *s_check_bitmap;
 static TextLayer *s_ready_text_layer;
+static bool s_action_bar_shown = false;
 
 // Reference variables
 static AppTimer *s_countdown_timer;
 static AppTimer *s_vibrate_timer;
+static AppTimer *s_watch_timer;
+static Animation *s_fill_animation;
 
 // Other variables
 static time_t s_wakeup_timestamp = 0;
-static uint8_t s_countdown_percentage = 0;
 static uint16_t s_countdown_duration = 1;
 static uint8_t vibrate_count = 0;
+static uint8_t vibrate_repeats = 3;
 static uint8_t s_count_mode;
+static uint8_t s_tea;
+
+// Animation variables
+#define WATCH_TIMEOUT_MS    5000 // Animate for this long after a press or tap
+#define FRAME_BUDGET_MS     10   // Draw time allowed per animation frame
+#define FRAME_MIN_MS        33   // Fastest animation frame rate (~30 fps)
+#define FRAME_MAX_MS        250  // Slowest frame rate before giving up
+static uint16_t s_display_fill = 0; // Thousandths of a full cup
+static uint16_t s_frame_ms = FRAME_MIN_MS;
+static uint32_t s_last_frame_ms = 0;
+static bool s_animation_enabled = false;
 
 /********************/
-/*  WINDOW DISPLAY  */
+/*  INIT & DEINIT   */
 /********************/
 
-// Remotely callable function to display the window
-void countdown_display() {
-  // Force a window update if already displayed
-  window_stack_remove(s_countdown_window, false);
-  
-  // Create window
+// Create the window and everything it shows once, so that state changes
+// only reconfigure them instead of fragmenting the heap
+void countdown_init() {
   s_countdown_window = window_create();
   window_set_window_handlers(s_countdown_window, (WindowHandlers){
     .load = countdown_window_load,
     .unload = countdown_window_unload,
   });
-    
-  // Display window
-  window_stack_push(s_countdown_window, false);
-}
-
-// Loading code for the window
-static void countdown_window_load(Window *window) {
-  Layer *window_layer = window_get_root_layer(window);
+  
+  Layer *window_layer = window_get_root_layer(s_countdown_window);
   GRect bounds = layer_get_bounds(window_layer);
   
+  // Action bar, added to the window while counting down
+  s_cross_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_CROSS);
+  s_check_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_CHECK);
+  s_action_bar_layer = action_bar_layer_create();
+  
+  // Create canvas Layer and set up the update procedure
+  s_tea_cup_canvas_layer = layer_create(bounds);
+  layer_set_update_proc(s_tea_cup_canvas_layer, countdown_update_layer);
+  layer_add_child(window_layer, s_tea_cup_canvas_layer);
+  
+  // State text
+  s_ready_text_layer = text_layer_create(GRect(0, bounds.size.h / 2 + 25, bounds.size.w, 40));
+  text_layer_set_text_alignment(s_ready_text_layer, GTextAlignmentCenter);
+  text_layer_set_font(s_ready_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
+  text_layer_set_background_color(s_ready_text_layer, GColorClear);
+  layer_add_child(window_layer, text_layer_get_layer(s_ready_text_layer));
+}
+
+/********************/
+/*  WINDOW DISPLAY  */
+/********************/
+
+// Remotely callable function to display the window from storage
+void countdown_display() {
   // Get stored variables
   WakeupId wakeup_id = persist_read_int(PERSIST_WAKEUP);
   wakeup_query(wakeup_id, &s_wakeup_timestamp);
   s_countdown_duration = persist_read_int(PERSIST_DURATION);
   s_count_mode = persist_read_int(PERSIST_COUNT_MODE);
+  s_tea = persist_read_int(PERSIST_TEA);
+  
+  countdown_push_window();
+}
 
+// Remotely callable function to display the window from a known state
+void countdown_display_state(uint8_t count_mode, time_t wakeup_timestamp, uint16_t duration, uint8_t tea) {
+  s_wakeup_timestamp = wakeup_timestamp;
+  s_countdown_duration = duration > 0 ? duration : 1;
+  s_count_mode = count_mode;
+  s_tea = tea;
+  
+  countdown_push_window();
+}
+
+// Reload the window with the current state
+static void countdown_push_window() {
+  // Force a window update if already displayed
+  window_stack_remove(s_countdown_window, false);
+    
+  // Display window
+  window_stack_push(s_countdown_window, false);
+}
+
+// Loading code for the window, only configures what countdown_init created
+static void countdown_window_load(Window *window) {
   // Display action bar while counting down
   if(s_count_mode != 2) {
-    s_cross_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_CROSS);
-    s_check_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_CHECK);
-    s_action_bar_layer = action_bar_layer_create();
     if(s_count_mode == 1 && s_vibrate_timer)
       action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_SELECT, s_check_bitmap);
     else
       action_bar_layer_set_icon(s_action_bar_layer, BUTTON_ID_SELECT, s_cross_bitmap);
     action_bar_layer_set_click_config_provider(s_action_bar_layer, countdown_click_config_provider);
     action_bar_layer_add_to_window(s_action_bar_layer, window);
+    s_action_bar_shown = true;
   }
   else
     window_set_click_config_provider(window, completed_click_config_provider);
@@ -91,17 +157,17 @@ static void countdown_window_load(Window *window) {
   if(s_count_mode != 2)
     s_countdown_timer = app_timer_register(0, countdown_timer_handler, NULL);
   
-  // Create canvas Layer and set up the update procedure
-  s_tea_cup_canvas_layer = layer_create(bounds);
-  layer_set_update_proc(s_tea_cup_canvas_layer, countdown_update_layer);
-  layer_add_child(window_layer, s_tea_cup_canvas_layer);
+  // Animate the fill while watched, if enabled and the power profile allows
+  // it, so the accelerometer stays off otherwise
+  s_animation_enabled = s_count_mode != 2 && persist_read_int(PERSIST_ANIMATE) != 0 && power_get_profile()->animate;
+  if(s_animation_enabled)
+    accel_tap_service_subscribe(countdown_tap_handler);
   
   // Display text based on state
-  s_ready_text_layer = text_layer_create(GRect(0, bounds.size.h / 2 + 25, bounds.size.w, 40));
   switch(s_count_mode) {
     case 0:
       // Matcha tea
-      if(persist_read_int(PERSIST_TEA) == 4)
+      if(s_tea == 4)
         text_layer_set_text(s_ready_text_layer, "Whisk");
       else
         text_layer_set_text(s_ready_text_layer, "Let it steep");
@@ -113,10 +179,6 @@ static void countdown_window_load(Window *window) {
       text_layer_set_text(s_ready_text_layer, "Let it cool");
       break;
   }
-  text_layer_set_text_alignment(s_ready_text_layer, GTextAlignmentCenter);
-  text_layer_set_font(s_ready_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  text_layer_set_background_color(s_ready_text_layer, GColorClear);
-  layer_add_child(window_layer, text_layer_get_layer(s_ready_text_layer));
   
   // Change background color
   #ifdef PBL_COLOR
@@ -139,7 +201,26 @@ static void countdown_window_load(Window *window) {
 
 // Update the display layer
 static void countdown_update_layer(Layer *layer, GContext *ctx) {
-  tea_cup_draw(layer, ctx, (s_count_mode == 2 ? 100 : s_countdown_percentage), s_count_mode != 2);
+  uint32_t start_ms = countdown_now_ms();
+  
+  tea_cup_draw(layer, ctx, (s_count_mode == 2 ? 1000 : s_display_fill), s_count_mode != 2);
+  
+  // Only animated frames are measured
+  if(!s_fill_animation)
+    return;
+  
+  // Slow down when over budget, speed back up when well under it
+  uint32_t draw_ms = countdown_now_ms() - start_ms;
+  if(draw_ms > FRAME_BUDGET_MS) {
+    if(s_frame_ms >= FRAME_MAX_MS) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "Frame took %u ms, animation stopped", (unsigned) draw_ms);
+      fill_animation_stop();
+    }
+    else
+      s_frame_ms *= 2;
+  }
+  else if(draw_ms < FRAME_BUDGET_MS / 2 && s_frame_ms > FRAME_MIN_MS)
+    s_frame_ms /= 2;
 }
 
 /********************/
@@ -153,19 +234,26 @@ static void countdown_back_handler(ClickRecognizerRef recognizer, void *context)
 
 // Set select button handler to cancel
 static void countdown_cancel_handler(ClickRecognizerRef recognizer, void *context) {
+  // Cancel the brew owned by the worker
+  if(brew_worker_running())
+    brew_cancel();
+  
   // Cancel the wakeup
   if (persist_exists(PERSIST_WAKEUP)) {
     // Cancel the wakeup
     WakeupId wakeup_id = persist_read_int(PERSIST_WAKEUP);
     if(wakeup_query(wakeup_id, NULL))
       wakeup_cancel(wakeup_id);
+    
+    // Clear the storage
+    persist_delete(PERSIST_WAKEUP);
+    persist_delete(PERSIST_DURATION);
+    persist_delete(PERSIST_COUNT_MODE);
+    persist_delete(PERSIST_TEA);
   }
   
-  // Clear the storage
-  persist_delete(PERSIST_WAKEUP);
-  persist_delete(PERSIST_DURATION);
-  persist_delete(PERSIST_COUNT_MODE);
-  persist_delete(PERSIST_TEA);
+  // Remove from the launcher
+  glance_clear();
   
   // Close current window
   window_stack_pop(true);
@@ -176,7 +264,7 @@ static void vibrate_cancel_handler(ClickRecognizerRef recognizer, void *context)
   if(s_vibrate_timer)
     app_timer_cancel(s_vibrate_timer);
   s_vibrate_timer = NULL;
-  countdown_display();
+  countdown_push_window();
 }
 
 // Function called on button press
@@ -186,6 +274,8 @@ static void countdown_click_config_provider(void *context) {
     window_single_click_subscribe(BUTTON_ID_SELECT, vibrate_cancel_handler);
   else
     window_single_click_subscribe(BUTTON_ID_SELECT, countdown_cancel_handler);
+  window_single_click_subscribe(BUTTON_ID_UP, countdown_watch_handler);
+  window_single_click_subscribe(BUTTON_ID_DOWN, countdown_watch_handler);
 }
 static void completed_click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_BACK, countdown_back_handler);
@@ -203,18 +293,39 @@ void countdown_destroy() {
   window_stack_remove(s_countdown_window, true);
 }
 
+// Release everything countdown_init created, once the app exits
+void countdown_deinit() {
+  // Unload first, it still detaches the action bar
+  window_stack_remove(s_countdown_window, false);
+  
+  action_bar_layer_destroy(s_action_bar_layer);
+  gbitmap_destroy(s_cross_bitmap);
+  gbitmap_destroy(s_check_bitmap);
+  text_layer_destroy(s_ready_text_layer);
+  layer_destroy(s_tea_cup_canvas_layer);
+  window_destroy(s_countdown_window);
+}
+
 // Unloading code
 static void countdown_window_unload(Window *window) {
-  // Destroy interface
-  layer_destroy(s_tea_cup_canvas_layer);
-  tea_cup_destroy();
-  if(s_count_mode != 2) {
-    action_bar_layer_destroy(s_action_bar_layer);
-    gbitmap_destroy(s_cross_bitmap);
-    gbitmap_destroy(s_check_bitmap);
+  // Stop timers and animation
+  if(s_countdown_timer)
+    app_timer_cancel(s_countdown_timer);
+  s_countdown_timer = NULL;
+  if(s_animation_enabled) {
+    accel_tap_service_unsubscribe();
+    s_animation_enabled = false;
+  }
+  if(s_watch_timer)
+    app_timer_cancel(s_watch_timer);
+  s_watch_timer = NULL;
+  fill_animation_stop();
+  
+  // Detach the action bar, the window is kept for the next state
+  if(s_action_bar_shown) {
+    action_bar_layer_remove_from_window(s_action_bar_layer);
+    s_action_bar_shown = false;
   }
-  text_layer_destroy(s_ready_text_layer);
-  window_destroy(window);
 }
 
 /********************/
@@ -223,44 +334,50 @@ static void countdown_window_unload(Window *window) {
 
 // Countdown timer
 static void countdown_timer_handler(void *data) {
-  // Get progress
-  s_countdown_percentage = (s_countdown_duration - (s_wakeup_timestamp - time(NULL))) * 100 / s_countdown_duration;
-  if(s_count_mode == 1)
-    s_countdown_percentage = 100 - s_countdown_percentage;
- 
-  // Update layer
-  if(s_tea_cup_canvas_layer)
-    layer_mark_dirty(s_tea_cup_canvas_layer);
+  // Step to the current level, the animation moves it while watched
+  if(!s_fill_animation) {
+    s_display_fill = countdown_fill();
+    
+    // Update layer
+    if(s_tea_cup_canvas_layer)
+      layer_mark_dirty(s_tea_cup_canvas_layer);
+  }
+  
+  // Schedule next event every tick, as often as the power profile allows
+  const PowerProfile *profile = power_get_profile();
+  uint32_t delay = s_countdown_duration * 1000 / profile->frames;
+  if(delay < profile->min_frame_ms)
+    delay = profile->min_frame_ms;
   
-  // Schedule next event every tick
   if(s_count_mode != 2)
-    s_countdown_timer = app_timer_register(s_countdown_duration * 1000 / 38, countdown_timer_handler, data);
+    s_countdown_timer = app_timer_register(delay, countdown_timer_handler, data);
   else
     s_countdown_timer = NULL;
 }
 
 // Vibration timer
 static void wakeup_vibrate_handler(void *data) {
-  if(vibrate_count < 3) {
+  if(vibrate_count < vibrate_repeats) {
     // Vibrate the watch
     vibes_double_pulse();
     
     // Call back in 10 seconds
     s_vibrate_timer = app_timer_register(10 * 1000, wakeup_vibrate_handler, data);
   }
-  else if(vibrate_count == 3) {
+  else if(vibrate_count == vibrate_repeats) {
     if(s_count_mode == 2)
-      // Wait for 2 minutes then close the app if tea is ready
-      s_vibrate_timer = app_timer_register(2 * 60 * 1000, wakeup_vibrate_handler, data);
+      // Wait for the linger timeout then close the app if tea is ready
+      s_vibrate_timer = app_timer_register(power_get_profile()->linger_ms, wakeup_vibrate_handler, data);
     else {
       // Otherwise remove the option to dismiss vibration
       s_vibrate_timer = NULL;
-      countdown_display();
+      countdown_push_window();
     }
   }
   else {
     // Vibrate one last time
-    vibes_double_pulse();
+    if(power_get_profile()->final_pulse)
+      vibes_double_pulse();
     
     // Close after the timeout
     window_stack_pop_all(true);
@@ -270,52 +387,178 @@ static void wakeup_vibrate_handler(void *data) {
   vibrate_count++;
 }
 
+/********************/
+/*    ANIMATION     */
+/********************/
+
+// Milliseconds clock, only meant for differences
+static uint32_t countdown_now_ms() {
+  time_t seconds;
+  uint16_t milliseconds;
+  time_ms(&seconds, &milliseconds);
+  return (uint32_t) seconds * 1000 + milliseconds;
+}
+
+// Brewing or cooling progress in thousandths, from the wall clock
+static uint16_t countdown_fill() {
+  time_t seconds;
+  uint16_t milliseconds;
+  time_ms(&seconds, &milliseconds);
+  
+  int32_t remaining_ms = (int32_t) (s_wakeup_timestamp - seconds) * 1000 - milliseconds;
+  int32_t duration_ms = (int32_t) s_countdown_duration * 1000;
+  if(remaining_ms < 0)
+    remaining_ms = 0;
+  else if(remaining_ms > duration_ms)
+    remaining_ms = duration_ms;
+  
+  uint16_t fill = (duration_ms - remaining_ms) / s_countdown_duration;
+  return s_count_mode == 1 ? 1000 - fill : fill;
+}
+
+// Up or down press
+static void countdown_watch_handler(ClickRecognizerRef recognizer, void *context) {
+  countdown_watch_start();
+}
+
+// Wrist flick
+static void countdown_tap_handler(AccelAxisType axis, int32_t direction) {
+  countdown_watch_start();
+}
+
+// Animate for a few seconds, unless the power profile forbids it
+static void countdown_watch_start() {
+  if(!s_animation_enabled || s_count_mode == 2 || !power_get_profile()->animate)
+    return;
+  
+  if(s_watch_timer)
+    app_timer_reschedule(s_watch_timer, WATCH_TIMEOUT_MS);
+  else
+    s_watch_timer = app_timer_register(WATCH_TIMEOUT_MS, countdown_watch_timeout_handler, NULL);
+  
+  if(!s_fill_animation) {
+    s_frame_ms = FRAME_MIN_MS;
+    fill_animation_start();
+  }
+}
+
+// Back to the stepped fill
+static void countdown_watch_timeout_handler(void *data) {
+  s_watch_timer = NULL;
+  fill_animation_stop();
+  s_display_fill = countdown_fill();
+  if(s_tea_cup_canvas_layer)
+    layer_mark_dirty(s_tea_cup_canvas_layer);
+}
+
+// One animation per watch session, only used as a frame clock
+static void fill_animation_start() {
+  static const AnimationImplementation implementation = {
+    .update = fill_animation_update
+  };
+  
+  s_last_frame_ms = 0;
+  s_fill_animation = animation_create();
+  animation_set_duration(s_fill_animation, ANIMATION_DURATION_INFINITE);
+  animation_set_implementation(s_fill_animation, &implementation);
+  animation_set_handlers(s_fill_animation, (AnimationHandlers){
+    .stopped = fill_animation_stopped
+  }, NULL);
+  animation_schedule(s_fill_animation);
+}
+
+static void fill_animation_stop() {
+  if(s_fill_animation)
+    animation_unschedule(s_fill_animation);
+  s_fill_animation = NULL;
+}
+
+// Follow the clock, but only redraw as often as the frame rate allows
+static void fill_animation_update(Animation *animation, const AnimationProgress progress) {
+  uint32_t now_ms = countdown_now_ms();
+  if(now_ms - s_last_frame_ms < s_frame_ms)
+    return;
+  s_last_frame_ms = now_ms;
+  
+  // Only redraw once the cup would look different
+  uint16_t fill = countdown_fill();
+  if(tea_cup_level(fill) == tea_cup_level(s_display_fill))
+    return;
+  s_display_fill = fill;
+  
+  if(s_tea_cup_canvas_layer)
+    layer_mark_dirty(s_tea_cup_canvas_layer);
+}
+
+// Animations are destroyed by the system once stopped
+static void fill_animation_stopped(Animation *animation, bool finished, void *context) {
+  if(s_fill_animation == animation)
+    s_fill_animation = NULL;
+}
+
 /********************/
 /*      WAKEUP      */
 /********************/
 
+// Start alerting, before the window is displayed
+void countdown_alert() {
+  vibrate_count = 0;
+  vibrate_repeats = power_get_profile()->vibe_repeats;
+  s_vibrate_timer = app_timer_register(0, wakeup_vibrate_handler, NULL);
+}
+
+// Time for the tea to cool once steeped, 0 if no reminder is needed
+int countdown_cool_delay(int tea, int steep_time) {
+  // Tea's ready feature is disabled
+  if(persist_read_int(PERSIST_READY) == 0)
+    return 0;
+  
+  // Reduce the delay by the time needed to steep
+  int delay = -steep_time;
+  
+  // Adjust the delay based on the tea's initial temperature
+  delay += (get_tea_temp(tea) - 80) * 0.5 * 60;
+  
+  // Increase the delay based on the selected temperature
+  switch(persist_read_int(PERSIST_READY)) {
+    case 2:
+      delay += 6 * 60;
+      break;
+    case 3:
+      delay += 14 * 60;
+      break;
+    case 4:
+      delay += 24 * 60;
+  }
+  
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Tea should cool for %i seconds", delay);
+  
+  // Only setup notification if the delay is longer than 30 seconds
+  return delay > 30 ? delay : 0;
+}
+
 // Handle wakeup calls
 void wakeup_timer_handler(WakeupId id, int32_t reason) {
   // Set to tea complete
   persist_write_int(PERSIST_COUNT_MODE, 2);
   
-  // Wakeup not due to "Tea's ready" feature and it is enabled
-  if(reason != -1 && persist_read_int(PERSIST_READY) != 0) {
-    time_t wakeup_time = time(NULL);
-    int delay = 0;
+  // Wakeup not due to "Tea's ready" feature
+  int delay = 0;
+  if(reason != -1) {
+    delay = countdown_cool_delay(reason, persist_exists(PERSIST_DURATION) ? persist_read_int(PERSIST_DURATION) : 0);
     
-    // Reduce the delay by the time needed to steep
-    if (persist_exists(PERSIST_DURATION))
-      delay -= persist_read_int(PERSIST_DURATION);
-    
-    // Adjust the delay based on the tea's initial temperature
-    delay += (get_tea_temp(reason) - 80) * 0.5 * 60;
-    
-    // Increase the delay based on the selected temperature
-    switch(persist_read_int(PERSIST_READY)) {
-      case 2:
-        delay += 6 * 60;
-        break;
-      case 3:
-        delay += 14 * 60;
-        break;
-      case 4:
-        delay += 24 * 60;
-    }
-    
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Tea should cool for %i seconds", delay);
-    
-    // Only setup notification if the delay is longer than 30 seconds
-    if(delay > 30) {
-      persist_write_int(PERSIST_WAKEUP, wakeup_schedule(wakeup_time + delay, -1, false));
+    if(delay > 0) {
+      persist_write_int(PERSIST_WAKEUP, wakeup_schedule(time(NULL) + delay, -1, false));
       persist_write_int(PERSIST_DURATION, delay);
       persist_write_int(PERSIST_COUNT_MODE, 1);
     }
   }
   
+  // Publish to the launcher
+  glance_update(delay > 0 ? 1 : 2, time(NULL) + delay, 0, persist_read_int(PERSIST_TEA));
+  
   // Vibrate
-  vibrate_count = 0;
-  s_vibrate_timer = app_timer_register(0, wakeup_vibrate_handler, NULL);
+  countdown_alert();
     
   // Display the countdown
   countdown_display();
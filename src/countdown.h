@@ -5,6 +5,11 @@
 /*     FUNCTION     */
 /********************/
 
+void countdown_alert();
+int countdown_cool_delay(int, int);
+void countdown_deinit();
 void countdown_destroy();
 void countdown_display();
+void countdown_display_state(uint8_t, time_t, uint16_t, uint8_t);
+void countdown_init();
 void wakeup_timer_handler(WakeupId, int32_t);
\ No newline at end of file
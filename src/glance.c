@@ -0,0 +1,106 @@
+#include "glance.h"
+#include "keys.h"
+#include "menu.h"
+
+// App glances only exist on SDK 4 firmware
+#if defined(PBL_API_EXISTS)
+#if PBL_API_EXISTS(app_glance_reload)
+#define GLANCE_ENABLED
+#endif
+#endif
+
+#ifdef GLANCE_ENABLED
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+static void glance_add_slice(AppGlanceReloadSession*, const char*, time_t);
+static void glance_reload_callback(AppGlanceReloadSession*, size_t, void*);
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+// Brew to publish
+static uint8_t s_count_mode = WORKER_MODE_IDLE;
+static time_t s_end_time;
+static uint16_t s_cool_delay;
+static uint8_t s_tea;
+
+// Slice text, must outlive the reload session
+static char s_steep_text[64];
+static char s_cool_text[64];
+
+/********************/
+/*      SLICES      */
+/********************/
+
+static void glance_add_slice(AppGlanceReloadSession *session, const char *text, time_t expiration_time) {
+  AppGlanceSlice slice = {
+    .layout = {
+      .icon = APP_GLANCE_SLICE_DEFAULT_ICON,
+      .subtitle_template_string = text
+    },
+    .expiration_time = expiration_time
+  };
+  app_glance_add_slice(session, slice);
+}
+
+// Describe every phase left, the launcher moves on by itself as they expire
+static void glance_reload_callback(AppGlanceReloadSession *session, size_t limit, void *context) {
+  const char *texts[3];
+  time_t expirations[3];
+  size_t count = 0;
+  time_t end_time = s_end_time;
+  
+  if(s_count_mode == WORKER_MODE_IDLE)
+    return;
+  
+  if(s_count_mode == 0) {
+    snprintf(s_steep_text, sizeof(s_steep_text), "%s ready {time_until(%ld)|format('%%aT')}", get_tea_name(s_tea), (long) end_time);
+    texts[count] = s_steep_text;
+    expirations[count++] = end_time;
+    
+    // Cooling follows right after steeping
+    end_time += s_cool_delay;
+  }
+  if(s_count_mode == 1 || (s_count_mode == 0 && s_cool_delay > 0)) {
+    snprintf(s_cool_text, sizeof(s_cool_text), "Cool {time_until(%ld)|format('%%aT')}", (long) end_time);
+    texts[count] = s_cool_text;
+    expirations[count++] = end_time;
+  }
+  if(s_count_mode == 2)
+    end_time = time(NULL);
+  
+  // Keep the result up for a little while
+  texts[count] = "Enjoy your tea";
+  expirations[count++] = end_time + 10 * 60;
+  
+  // Soonest first, as many as the launcher takes
+  for(size_t i = 0; i < count && i < limit; i++)
+    glance_add_slice(session, texts[i], expirations[i]);
+}
+
+#endif
+
+/********************/
+/*     PUBLISH      */
+/********************/
+
+// Publish the brew in progress to the launcher, with the cooling time that
+// follows steeping
+void glance_update(uint8_t count_mode, time_t end_time, uint16_t cool_delay, uint8_t tea) {
+#ifdef GLANCE_ENABLED
+  s_count_mode = count_mode;
+  s_end_time = end_time;
+  s_cool_delay = cool_delay;
+  s_tea = tea;
+  app_glance_reload(glance_reload_callback, NULL);
+#endif
+}
+
+// Remove the brew from the launcher
+void glance_clear() {
+  glance_update(WORKER_MODE_IDLE, 0, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+#include <pebble.h>
+
+/********************/
+/*     FUNCTION     */
+/********************/
+
+void glance_clear();
+void glance_update(uint8_t, time_t, uint16_t, uint8_t);
\ No newline at end of file
@@ -7,14 +7,30 @@
 /********************/
 
 void inbox_received_handler(DictionaryIterator *iter, void *context) {
-  int i;
+  int i, writes = 0, reloads = 0;
+  time_t start_s;
+  uint16_t start_ms = time_ms(&start_s, NULL);
   
-  // Load all settings
-  for(i = PERSIST_READY; i <= PERSIST_TEA_MATCHA; i++) {
+  // Load all settings, only writing what changed
+  for(i = PERSIST_READY; i <= PERSIST_ANIMATE; i++) {
     Tuple *steep_time = dict_find(iter, i);
-    persist_write_int(i, steep_time->value->int32);
+    if(!steep_time || (steep_time->type != TUPLE_INT && steep_time->type != TUPLE_UINT))
+      continue;
+    
+    // A missing tea key means shown with its default, so 0 must be written
+    if(!persist_exists(i) || persist_read_int(i) != steep_time->value->int32) {
+      persist_write_int(i, steep_time->value->int32);
+      writes++;
+    }
   }
   
   // Refresh menu
-  menu_mark_dirty();
+  if(writes > 0 && menu_mark_dirty())
+    reloads++;
+  
+  // Report the cost of this sync
+  time_t end_s;
+  uint16_t end_ms = time_ms(&end_s, NULL);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Config sync: %u bytes, %d persist writes, %d menu reloads, %d ms",
+          (unsigned) dict_size(iter), writes, reloads, (int) ((end_s - start_s) * 1000 + end_ms - start_ms));
 }
\ No newline at end of file
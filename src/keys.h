@@ -2,6 +2,10 @@
 #define PERSIST_DURATION    1
 #define PERSIST_COUNT_MODE  2
 #define PERSIST_TEA         3
+#define PERSIST_WORKER      4
+#define PERSIST_LAST_TEA    5
+#define PERSIST_FAVORITE    6
+#define PERSIST_COOL_DELAY  7
 
 #define PERSIST_READY       8
 #define PERSIST_TEMP_UNIT   9
@@ -13,4 +17,18 @@
 #define PERSIST_TEA_PUERH   15
 #define PERSIST_TEA_ROOIBOS 16
 #define PERSIST_TEA_WHITE   17
-#define PERSIST_TEA_MATCHA  18
\ No newline at end of file
+#define PERSIST_TEA_MATCHA  18
+#define PERSIST_ANIMATE     19
+
+// Brew left for the worker to start once it is up
+#define PERSIST_BREW_START  20
+
+// Messages between the app and the background worker
+#define WORKER_BREW_START   0
+#define WORKER_BREW_CANCEL  1
+#define WORKER_BREW_QUERY   2
+#define WORKER_BREW_ACK     3
+#define WORKER_BREW_STATE   4
+
+// Count mode reported by the worker when no tea is brewing
+#define WORKER_MODE_IDLE    3
\ No newline at end of file
@@ -1,10 +1,18 @@
 #include <pebble.h>
+#include "brew.h"
 #include "countdown.h"
 #include "keys.h"
 #include "menu.h"
 #include "inbox.h"
+#include "power.h"
 
 static void init(void) {
+  // Pick a power profile before anything is drawn or scheduled
+  power_init();
+  
+  // Create the countdown resources once for the whole session
+  countdown_init();
+  
   // Check if the app was launched through a wakeup event
   if (launch_reason() == APP_LAUNCH_WAKEUP) {
     WakeupId id = 0;
@@ -15,31 +23,48 @@ static void init(void) {
     }
   }
   
-  // Display menu in all cases
-  menu_display();
+  // Ask the background worker for the brew in progress
+  brew_init();
   
   // Check if there is a scheduled event
+  bool scheduled = false;
   if (persist_exists(PERSIST_WAKEUP)) {
     WakeupId wakeup_id = persist_read_int(PERSIST_WAKEUP);
     
     // Query if the event is still valid
     if (wakeup_query(wakeup_id, NULL)) {
-      countdown_display();
+      scheduled = true;
     }
     else {
       persist_delete(PERSIST_WAKEUP);
     }
   }
+  bool brewing = scheduled || (brew_worker_running() && persist_exists(PERSIST_WORKER));
+  
+  // Quick launch starts the pinned or last tea right away, without building
+  // the menu; display it in all other cases
+  if (launch_reason() != APP_LAUNCH_QUICK_LAUNCH || brewing || !menu_quick_brew())
+    menu_display();
+  
+  if (scheduled)
+    countdown_display();
 
-  // Handle messages
+  // Handle messages, sized for one int32 tuple per setting
   app_message_register_inbox_received(inbox_received_handler);
-  app_message_open(APP_MESSAGE_INBOX_SIZE_MINIMUM, 0);
+  app_message_open(1 + (PERSIST_ANIMATE - PERSIST_READY + 1) * (sizeof(Tuple) + sizeof(int32_t)), 0);
   
   // Subscribe to wakeup service to get wakeup events while app is running
   wakeup_service_subscribe(wakeup_timer_handler);
 }
 
+static void deinit(void) {
+  countdown_deinit();
+  brew_deinit();
+  power_deinit();
+}
+
 int main(void) {
   init();
   app_event_loop();
+  deinit();
 }
@@ -1,4 +1,6 @@
+#include "brew.h"
 #include "countdown.h"
+#include "glance.h"
 #include "keys.h"
 #include "menu.h"
 
@@ -9,11 +11,15 @@
 static uint16_t menu_sections_count(struct MenuLayer*, uint16_t, void*);
 static void menu_draw_row(GContext*, const Layer*, MenuIndex*, void*);
 static void menu_select_callback(struct MenuLayer*, MenuIndex*, void*);
+static void menu_select_long_callback(struct MenuLayer*, MenuIndex*, void*);
 static void menu_window_load(Window*);
 static void menu_window_unload(Window*);
 
 static int get_tea_tount();
 static int get_tea_index_by_pos(int);
+static int get_tea_steep_time(int);
+static bool tea_shown(int);
+static bool tea_brew(int);
   
 #ifdef PBL_ROUND
 static int16_t menu_cell_height(MenuLayer*, MenuIndex*, void*);
@@ -25,6 +31,8 @@ static int16_t menu_cell_height(MenuLayer*, MenuIndex*, void*);
 
 // Display variables
 static char s_tea_text[32];
+static char s_tea_name[12];
+static int s_favorite = -1;
 static MenuLayer *s_menu_layer;
 static Window *s_menu_window;
 
@@ -68,12 +76,16 @@ static void menu_window_load(Window *window) {
   // Create menu layer
   s_menu_layer = menu_layer_create(bounds);
   
+  // Pinned tea is marked in the list
+  s_favorite = persist_exists(PERSIST_FAVORITE) ? persist_read_int(PERSIST_FAVORITE) : -1;
+  
   // Setup menu control
   menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks){
     .get_num_rows = menu_sections_count,
     .get_cell_height = PBL_IF_ROUND_ELSE(menu_cell_height, NULL),
     .draw_row = menu_draw_row,
-    .select_click = menu_select_callback
+    .select_click = menu_select_callback,
+    .select_long_click = menu_select_long_callback
   }); 
   menu_layer_set_click_config_onto_window(s_menu_layer,	window);
   
@@ -102,8 +114,7 @@ static int16_t menu_cell_height(MenuLayer *menu_layer, MenuIndex *cell_index, vo
 static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *callback_context) {
   int index = get_tea_index_by_pos(cell_index->row);
   char* name = tea_array[index].name;
-  int persist_key = tea_array[index].persist_key;
-  int steep_time = (persist_read_int(persist_key) != 0 ? persist_read_int(persist_key) : tea_array[index].def_time);
+  int steep_time = get_tea_steep_time(index);
   int temp = tea_array[index].temp;
   char* temp_unit_identifier = "°C";
   
@@ -132,6 +143,12 @@ static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cel
   else
     snprintf(s_tea_text, sizeof(s_tea_text), "%u secs (%u%s)", steep_time, temp, temp_unit_identifier);
   
+  // Mark the pinned tea
+  if(index == s_favorite) {
+    snprintf(s_tea_name, sizeof(s_tea_name), "%s *", name);
+    name = s_tea_name;
+  }
+  
   // Draw the cell
   menu_cell_basic_draw(ctx, cell_layer, name, s_tea_text, NULL);
 }
@@ -142,35 +159,58 @@ static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cel
 
 // Function called on select press
 static void menu_select_callback(struct MenuLayer *s_menu_layer, MenuIndex *cell_index, void *callback_context) {
+  tea_brew(get_tea_index_by_pos(cell_index->row));
+}
+
+// Function called on long select press, pins or unpins the tea for quick brew
+static void menu_select_long_callback(struct MenuLayer *s_menu_layer, MenuIndex *cell_index, void *callback_context) {
   int index = get_tea_index_by_pos(cell_index->row);
-  int persist_key = tea_array[index].persist_key;
-  int steep_time = (persist_read_int(persist_key) != 0 ? persist_read_int(persist_key) : tea_array[index].def_time);
   
-  // Calculate time to wakeup
-  time_t wakeup_time = time(NULL) + steep_time;
+  if(index == s_favorite) {
+    persist_delete(PERSIST_FAVORITE);
+    s_favorite = -1;
+  }
+  else {
+    persist_write_int(PERSIST_FAVORITE, index);
+    s_favorite = index;
+  }
+  
+  vibes_short_pulse();
+  menu_layer_reload_data(s_menu_layer);
+}
 
-  // Schedule the wakeup with the tea ID as reason
-  WakeupId s_wakeup_id = wakeup_schedule(wakeup_time, index, false);
+/********************/
+/*    QUICK BREW    */
+/********************/
 
-  // Continue if wakeup event was scheduled
-  if (s_wakeup_id > 0) {
-    // Store information about the countdown in progress
-    persist_write_int(PERSIST_WAKEUP, s_wakeup_id);
-    persist_write_int(PERSIST_DURATION, steep_time);
-    persist_write_int(PERSIST_COUNT_MODE, 0);
-    persist_write_int(PERSIST_TEA, index);
-  
-    // Switch to countdown window
-    countdown_display();
-  }
+// Remotely callable function to brew the pinned or last tea without the menu
+bool menu_quick_brew() {
+  int index;
+  
+  // Skip teas hidden from the menu since they were pinned or brewed
+  if(persist_exists(PERSIST_FAVORITE) && tea_shown(persist_read_int(PERSIST_FAVORITE)))
+    index = persist_read_int(PERSIST_FAVORITE);
+  else if(persist_exists(PERSIST_LAST_TEA) && tea_shown(persist_read_int(PERSIST_LAST_TEA)))
+    index = persist_read_int(PERSIST_LAST_TEA);
+  else
+    return false;
+  
+  // The countdown is shown right away, the app stays open while brewing
+  return tea_brew(index);
 }
 
 /********************/
 /*  WINDOW DESTROY  */
 /********************/
 
-void menu_mark_dirty() {
+// Reload the menu, false if it is not built
+bool menu_mark_dirty() {
+  // The menu is never built after a quick brew
+  if(!s_menu_layer)
+    return false;
+  
   menu_layer_reload_data(s_menu_layer);
+  return true;
 }
 
 // Remotely callable function to kill the window
@@ -181,6 +221,7 @@ void menu_destroy() {
 // Unloading code
 static void menu_window_unload(Window *window) {
   menu_layer_destroy(s_menu_layer);
+  s_menu_layer = NULL;
   window_destroy(window);
 }
 
@@ -206,6 +247,56 @@ static int get_tea_index_by_pos(int position) {
   return 1;
 }
 
+// Teas set to 0 minutes are hidden
+static bool tea_shown(int index) {
+  if(index < 0 || index >= (int) ARRAY_LENGTH(tea_array))
+    return false;
+  return !persist_exists(tea_array[index].persist_key) || persist_read_int(tea_array[index].persist_key) != 0;
+}
+
+static int get_tea_steep_time(int index) {
+  int persist_key = tea_array[index].persist_key;
+  return (persist_read_int(persist_key) != 0 ? persist_read_int(persist_key) : tea_array[index].def_time);
+}
+
+// Start brewing a tea, false if it could not be scheduled
+static bool tea_brew(int index) {
+  int steep_time = get_tea_steep_time(index);
+  
+  // Remember it for quick brew
+  persist_write_int(PERSIST_LAST_TEA, index);
+  
+  // Let the worker own the brew, showing it until the worker reports back
+  int cool_delay = countdown_cool_delay(index, steep_time);
+  if(brew_start(index, steep_time, cool_delay)) {
+    countdown_display_state(0, time(NULL) + steep_time, steep_time, index);
+    return true;
+  }
+  
+  // Calculate time to wakeup
+  time_t wakeup_time = time(NULL) + steep_time;
+
+  // Schedule the wakeup with the tea ID as reason
+  WakeupId s_wakeup_id = wakeup_schedule(wakeup_time, index, false);
+
+  // Continue if wakeup event was scheduled
+  if (s_wakeup_id <= 0)
+    return false;
+  
+  // Store information about the countdown in progress
+  persist_write_int(PERSIST_WAKEUP, s_wakeup_id);
+  persist_write_int(PERSIST_DURATION, steep_time);
+  persist_write_int(PERSIST_COUNT_MODE, 0);
+  persist_write_int(PERSIST_TEA, index);
+  
+  // Publish to the launcher
+  glance_update(0, wakeup_time, cool_delay, index);
+
+  // Switch to countdown window
+  countdown_display();
+  return true;
+}
+
 static int get_tea_tount() {
   int count = 0, i;
   
@@ -222,6 +313,10 @@ static int get_tea_tount() {
   return count;
 }
 
+char* get_tea_name(int index) {
+  return tea_array[index].name;
+}
+
 int get_tea_temp(int index) {
   return tea_array[index].temp;
 }
\ No newline at end of file
@@ -18,5 +18,7 @@ typedef struct {
 
 void menu_destroy();
 void menu_display();
-void menu_mark_dirty();
+bool menu_mark_dirty();
+bool menu_quick_brew();
+char* get_tea_name(int);
 int get_tea_temp(int);
\ No newline at end of file
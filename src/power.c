@@ -0,0 +1,65 @@
+#include "power.h"
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+static void power_battery_handler(BatteryChargeState);
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+// Profiles, from most to least expensive
+static const PowerProfile profile_array[] = {
+  {"Full", 38, 0, 3, true, 2 * 60 * 1000, true},
+  {"Saver", 19, 10 * 1000, 2, true, 60 * 1000, true},
+  {"Low", 38, 60 * 1000, 1, false, 30 * 1000, false}
+};
+
+// Active profile
+static uint8_t s_profile_index = 0;
+
+/********************/
+/*     BATTERY      */
+/********************/
+
+// Pick a profile from the battery state
+static void power_battery_handler(BatteryChargeState state) {
+  uint8_t index;
+  
+  if(state.is_plugged || state.charge_percent > 40)
+    index = 0;
+  else if(state.charge_percent > 20)
+    index = 1;
+  else
+    index = 2;
+  
+  if(index != s_profile_index)
+    APP_LOG(APP_LOG_LEVEL_INFO, "Power profile %s (battery %u%%)", profile_array[index].name, state.charge_percent);
+  
+  s_profile_index = index;
+}
+
+/********************/
+/*     PROFILE      */
+/********************/
+
+// Remotely callable function to get the active profile
+const PowerProfile* power_get_profile() {
+  return &profile_array[s_profile_index];
+}
+
+/********************/
+/*  INIT & DEINIT   */
+/********************/
+
+void power_init() {
+  power_battery_handler(battery_state_service_peek());
+  APP_LOG(APP_LOG_LEVEL_INFO, "Power profile %s", power_get_profile()->name);
+  battery_state_service_subscribe(power_battery_handler);
+}
+
+void power_deinit() {
+  battery_state_service_unsubscribe();
+}
\ No newline at end of file
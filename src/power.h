@@ -0,0 +1,24 @@
+#pragma once
+#include <pebble.h>
+
+/********************/
+/*     VARIABLE     */
+/********************/
+
+typedef struct {
+  char name[8];          // Name of this profile, for logging
+  uint8_t frames;        // Redraws spread over a whole countdown
+  uint32_t min_frame_ms; // Shortest delay between two redraws
+  uint8_t vibe_repeats;  // Alert pulses when the timer expires
+  bool final_pulse;      // Pulse once more before closing
+  uint32_t linger_ms;    // Time to keep the window once tea is ready
+  bool animate;          // Allow the animated fill while watched
+} PowerProfile;
+
+/********************/
+/*     FUNCTION     */
+/********************/
+
+void power_init();
+void power_deinit();
+const PowerProfile* power_get_profile();
\ No newline at end of file
@@ -4,16 +4,8 @@
 /*    VARIABLES     */
 /********************/
 
-// Display variable
-static GPath *s_tea_cup;
-static GPath *s_tea_cup_fill;
-static GPath *s_plate;
-static GPath *s_handle;
-static GPath *s_vapor_left;
-static GPath *s_vapor_right;
-
-// Path
-static GPathInfo s_path_tea_cup = {
+// Paths, static so drawing never touches the heap
+static GPath s_tea_cup = {
   .num_points = 6,
   .points = (GPoint []) {
     {0, 0}, // Cup - top left
@@ -24,7 +16,7 @@ static GPathInfo s_path_tea_cup = {
     {50, 0} // Cup - top right
   }
 };
-static GPathInfo s_path_tea_cup_fill = {
+static GPath s_tea_cup_fill = {
   .num_points = 6,
   .points = (GPoint []) {
     {0, 0}, // Cup - top left
@@ -35,7 +27,7 @@ static GPathInfo s_path_tea_cup_fill = {
     {50, 0} // Cup - top right
   }
 };
-static GPathInfo s_path_plate = {
+static GPath s_plate = {
   .num_points = 4,
   .points = (GPoint []) {
     {0, 0}, // Plate - top left
@@ -44,7 +36,7 @@ static GPathInfo s_path_plate = {
     {50, 0} // Plate - top right
   }
 };
-static GPathInfo s_path_handle = {
+static GPath s_handle = {
   .num_points = 6,
   .points = (GPoint []) {
     {12, 0}, // Handle - top right
@@ -55,108 +47,102 @@ static GPathInfo s_path_handle = {
     {12, 18} // Plate - bottom right
   }
 };
-static GPathInfo s_path_vapor = {
+static GPoint s_vapor_points[] = {
+  {10, 0}, // Handle - top right
+  {3, 7}, // Handle - center left
+  {7, 7}, // Handle - center right
+  {0, 14}, // Handle - bottom left
+};
+static GPath s_vapor_left = {
   .num_points = 4,
-  .points = (GPoint []) {
-    {10, 0}, // Handle - top right
-    {3, 7}, // Handle - center left
-    {7, 7}, // Handle - center right
-    {0, 14}, // Handle - bottom left
-  }
+  .points = s_vapor_points
+};
+static GPath s_vapor_right = {
+  .num_points = 4,
+  .points = s_vapor_points
 };
-
-// Other variables
-static uint8_t s_tea_cup_loaded;
 
 /********************/
 /*     DISPLAY      */
 /********************/
 
+// Level drawn for a fill, in thirds of a row on colour platforms and whole
+// rows otherwise, so two fills with the same level draw the same pixels
+uint8_t tea_cup_level(uint16_t fill_permille) {
+  if(fill_permille >= 1000)
+    return 40 * 3;
+  
+  uint8_t level = (fill_permille * 38 / 1000 + 1) * 3;
+  #ifdef PBL_COLOR
+  level += fill_permille * 38 % 1000 * 3 / 1000;
+  #endif
+  return level;
+}
+
 // Draw tea cup on context
-void tea_cup_draw(Layer *layer, GContext *ctx, uint8_t fill_percentage, bool vapor) {
+void tea_cup_draw(Layer *layer, GContext *ctx, uint16_t fill_permille, bool vapor) {
   GRect bounds = layer_get_bounds(layer);
-  if(fill_percentage < 100)
-    fill_percentage = fill_percentage / 100.0 * 38 + 1;
-  else
-    fill_percentage = 40;
   
-  // Initialize the tea cup
-  if(!s_tea_cup_loaded) {
-    s_tea_cup_loaded = 1;
-    
-    // Create path
-    s_tea_cup = gpath_create(&s_path_tea_cup);
-    s_tea_cup_fill = gpath_create(&s_path_tea_cup_fill);
-    s_plate = gpath_create(&s_path_plate);
-    s_handle = gpath_create(&s_path_handle);
+  // Whole rows of tea, and thirds of the row above them
+  uint8_t level = tea_cup_level(fill_permille);
+  uint8_t fill_percentage = level / 3;
+  uint8_t fill_part = level % 3;
   
-    // Translate to centre
-    gpath_move_to(s_tea_cup, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 - 23));
-    gpath_move_to(s_tea_cup_fill, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 - 23));
-    gpath_move_to(s_plate, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 + 17));
-    gpath_move_to(s_handle, GPoint(bounds.size.w / 2 - 37, bounds.size.h / 2 - 20));
-    
-    // Add vapor
-    if(vapor) {
-      s_vapor_left = gpath_create(&s_path_vapor);
-      s_vapor_right = gpath_create(&s_path_vapor);
-      gpath_move_to(s_vapor_left, GPoint(bounds.size.w / 2 - 10, bounds.size.h / 2 - 45));
-      gpath_move_to(s_vapor_right, GPoint(bounds.size.w / 2 + 6, bounds.size.h / 2 - 45));
-      s_tea_cup_loaded = 2;
-    }
-  }
+  // Translate to centre
+  gpath_move_to(&s_tea_cup, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 - 23));
+  gpath_move_to(&s_tea_cup_fill, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 - 23));
+  gpath_move_to(&s_plate, GPoint(bounds.size.w / 2 - 25, bounds.size.h / 2 + 17));
+  gpath_move_to(&s_handle, GPoint(bounds.size.w / 2 - 37, bounds.size.h / 2 - 20));
+  gpath_move_to(&s_vapor_left, GPoint(bounds.size.w / 2 - 10, bounds.size.h / 2 - 45));
+  gpath_move_to(&s_vapor_right, GPoint(bounds.size.w / 2 + 6, bounds.size.h / 2 - 45));
   
   // Setup fill path
   if(fill_percentage <= 15) {
     // Remove top points
-    s_path_tea_cup_fill.points[0] = GPoint(15 - fill_percentage, 40 - fill_percentage);
-    s_path_tea_cup_fill.points[5] = GPoint(35 + fill_percentage, 40 - fill_percentage);
+    s_tea_cup_fill.points[0] = GPoint(15 - fill_percentage, 40 - fill_percentage);
+    s_tea_cup_fill.points[5] = GPoint(35 + fill_percentage, 40 - fill_percentage);
     
     // Set centre points correctly
-    s_path_tea_cup_fill.points[1] = GPoint(15 - fill_percentage, 40 - fill_percentage);
-    s_path_tea_cup_fill.points[4] = GPoint(35 + fill_percentage, 40 - fill_percentage);
+    s_tea_cup_fill.points[1] = GPoint(15 - fill_percentage, 40 - fill_percentage);
+    s_tea_cup_fill.points[4] = GPoint(35 + fill_percentage, 40 - fill_percentage);
   }
   else {
     // Set top points correctly
-    s_path_tea_cup_fill.points[0] = GPoint(0, 40 - fill_percentage);
-    s_path_tea_cup_fill.points[5] = GPoint(50, 40 - fill_percentage);
+    s_tea_cup_fill.points[0] = GPoint(0, 40 - fill_percentage);
+    s_tea_cup_fill.points[5] = GPoint(50, 40 - fill_percentage);
     
     // Set centre points to default
-    s_path_tea_cup_fill.points[1] = GPoint(0, 25);
-    s_path_tea_cup_fill.points[4] = GPoint(50, 25);
+    s_tea_cup_fill.points[1] = GPoint(0, 25);
+    s_tea_cup_fill.points[4] = GPoint(50, 25);
   }
   
   // Fill
   graphics_context_set_fill_color(ctx, GColorBlack);
-  gpath_draw_filled(ctx, s_tea_cup);
+  gpath_draw_filled(ctx, &s_tea_cup);
   graphics_context_set_fill_color(ctx, GColorWhite);
-  gpath_draw_filled(ctx, s_plate);
-  gpath_draw_filled(ctx, s_tea_cup_fill);
+  gpath_draw_filled(ctx, &s_plate);
+  gpath_draw_filled(ctx, &s_tea_cup_fill);
+  
+  #ifdef PBL_COLOR
+  // Shade the partly filled row, so the level moves in steps finer than a pixel
+  if(fill_part > 0) {
+    uint8_t row = fill_percentage + 1;
+    int16_t left = row <= 15 ? 15 - row : 0;
+    GPoint origin = s_tea_cup_fill.offset;
+    graphics_context_set_stroke_color(ctx, fill_part == 1 ? GColorDarkGray : GColorLightGray);
+    graphics_context_set_stroke_width(ctx, 1);
+    graphics_draw_line(ctx, GPoint(origin.x + left, origin.y + 40 - row), GPoint(origin.x + 50 - left, origin.y + 40 - row));
+  }
+  #endif
   
   // Outline
   graphics_context_set_stroke_color(ctx, GColorBlack);
   graphics_context_set_stroke_width(ctx, 2);
-  gpath_draw_outline(ctx, s_plate);
-  gpath_draw_outline(ctx, s_tea_cup);
-  gpath_draw_outline(ctx, s_handle);
+  gpath_draw_outline(ctx, &s_plate);
+  gpath_draw_outline(ctx, &s_tea_cup);
+  gpath_draw_outline(ctx, &s_handle);
   if(vapor) {
-    gpath_draw_outline(ctx, s_vapor_left);
-    gpath_draw_outline(ctx, s_vapor_right);
-  }
-}
-
-// Destroy the tea cup
-void tea_cup_destroy() {
-  if(s_tea_cup_loaded > 0) {
-    gpath_destroy(s_tea_cup);
-    gpath_destroy(s_tea_cup_fill);
-    gpath_destroy(s_plate);
-    gpath_destroy(s_handle);
-    if(s_tea_cup_loaded > 1) {
-      gpath_destroy(s_vapor_left);
-      gpath_destroy(s_vapor_right);
-    }
-    
-    s_tea_cup_loaded = false;
+    gpath_draw_outline(ctx, &s_vapor_left);
+    gpath_draw_outline(ctx, &s_vapor_right);
   }
 }
\ No newline at end of file
@@ -5,5 +5,5 @@
 /*     FUNCTION     */
 /********************/
 
-void tea_cup_destroy();
-void tea_cup_draw(Layer*, GContext*, uint8_t, bool);
\ No newline at end of file
+void tea_cup_draw(Layer*, GContext*, uint16_t, bool);
+uint8_t tea_cup_level(uint16_t);
\ No newline at end of file
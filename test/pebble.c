@@ -0,0 +1,1307 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include "pebble.h"
+
+// Host implementation of pebble.h. Every SDK object is allocated from a
+// simulated app heap with a first fit allocator, so peak use and
+// fragmentation can be measured, and freed objects are poisoned so that a
+// use after destroy aborts instead of going unnoticed. Time only moves
+// inside pbl_run(), which dispatches timers, wakeups, worker messages and
+// animation frames in order and redraws dirty windows like the firmware.
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+static void die(const char*, ...);
+static void* heap_alloc(size_t, const char*);
+static void heap_free(void*);
+static void check(const void*, uint32_t, const char*);
+static void heap_track();
+static void render();
+static void animation_frame();
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+// Aplite's app heap, the smallest of all platforms
+#define HEAP_SIZE     (24 * 1024)
+#define HEAP_ALIGN    8
+#define FRAME_MS      33
+
+#define MAGIC_LAYER     0x4C415952
+#define MAGIC_WINDOW    0x57494E44
+#define MAGIC_TEXT      0x54455854
+#define MAGIC_ACTION    0x41435442
+#define MAGIC_MENU      0x4D454E55
+#define MAGIC_BITMAP    0x42544D50
+#define MAGIC_TIMER     0x54494D52
+#define MAGIC_ANIMATION 0x414E494D
+
+typedef struct {
+  uint32_t size; // Whole block, header included
+  uint32_t used;
+} HeapBlock;
+
+struct Layer {
+  uint32_t magic;
+  GRect bounds;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  LayerUpdateProc update_proc;
+  MenuLayer *menu;
+  bool dirty;
+};
+
+struct Window {
+  uint32_t magic;
+  Layer root;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config;
+  ActionBarLayer *action_bar;
+  ClickHandler clicks[NUM_BUTTONS];
+  GColor background;
+  bool loaded;
+};
+
+struct TextLayer {
+  uint32_t magic;
+  Layer layer;
+  const char *text;
+  GFont font;
+  GTextAlignment alignment;
+  GColor background;
+};
+
+struct ActionBarLayer {
+  uint32_t magic;
+  Layer layer;
+  Window *window;
+  ClickConfigProvider click_config;
+  const GBitmap *icons[NUM_BUTTONS];
+};
+
+struct MenuLayer {
+  uint32_t magic;
+  Layer layer;
+  MenuLayerCallbacks callbacks;
+  void *context;
+  GColor highlight[2];
+};
+
+struct GBitmap {
+  uint32_t magic;
+  uint32_t resource;
+  uint8_t pixels[72]; // 18x18 icon, 1 bit per pixel, rows padded to 4 bytes
+};
+
+struct AppTimer {
+  uint32_t magic;
+  uint64_t fire_ms;
+  AppTimerCallback callback;
+  void *data;
+  AppTimer *next;
+};
+
+struct Animation {
+  uint32_t magic;
+  const AnimationImplementation *implementation;
+  AnimationHandlers handlers;
+  void *context;
+  uint32_t duration;
+  uint64_t start_ms;
+  Animation *next;
+};
+
+struct GContext {
+  GColor fill;
+  GColor stroke;
+  uint8_t stroke_width;
+};
+
+typedef struct {
+  bool exists;
+  uint16_t length;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+typedef struct {
+  WakeupId id;
+  time_t timestamp;
+  int32_t reason;
+} WakeupEntry;
+
+PblCounters pbl_counters;
+
+// Heap
+static uint8_t s_heap[HEAP_SIZE] __attribute__((aligned(HEAP_ALIGN)));
+static bool s_heap_ready = false;
+static size_t s_heap_used = 0;
+static size_t s_heap_peak = 0;
+static uint32_t s_allocations = 0;
+static uint16_t s_worst_free_blocks = 0;
+static uint16_t s_worst_fragmentation = 0;
+
+// Clock, starting at an arbitrary date
+static uint64_t s_now_ms = 1700000000000ULL;
+static uint64_t s_last_frame_ms = 0;
+
+// Firmware state for the running app
+static Window *s_stack[8];
+static uint8_t s_stack_count = 0;
+static Window *s_click_window;
+static AppTimer *s_timers;
+static Animation *s_animations;
+static struct GContext s_context;
+static AppLaunchReason s_launch_reason = APP_LAUNCH_USER;
+static MenuLayer *s_menu;
+static int s_log_level = -1;
+
+// Services
+static BatteryChargeState s_battery = {100, false, false};
+static BatteryStateHandler s_battery_handler;
+static AccelTapHandler s_tap_handler;
+static WakeupHandler s_wakeup_handler;
+static AppMessageInboxReceived s_inbox_handler;
+static uint32_t s_inbox_size = 0;
+
+// Kept across launches, like the watch's flash
+static PersistEntry s_persist[64];
+static WakeupEntry s_wakeups[8];
+static WakeupId s_next_wakeup_id = 1;
+
+// Background worker
+static bool s_worker_available = false;
+static bool s_worker_running = false;
+static AppWorkerMessageHandler s_worker_handler;
+static void (*s_worker_hook)(uint8_t, AppWorkerMessage*);
+static struct {
+  uint16_t type;
+  AppWorkerMessage message;
+} s_worker_queue[8];
+static uint8_t s_worker_queued = 0;
+
+/********************/
+/*       HEAP       */
+/********************/
+
+static void die(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "pebble: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  abort();
+}
+
+#define BLOCK_AT(offset) ((HeapBlock*) (s_heap + (offset)))
+
+static void* heap_alloc(size_t size, const char *what) {
+  if(!s_heap_ready) {
+    BLOCK_AT(0)->size = HEAP_SIZE;
+    BLOCK_AT(0)->used = 0;
+    s_heap_ready = true;
+  }
+
+  // First fit, splitting the block if the rest is still usable
+  size_t need = (sizeof(HeapBlock) + size + HEAP_ALIGN - 1) & ~(size_t) (HEAP_ALIGN - 1);
+  for(size_t offset = 0; offset < HEAP_SIZE; offset += BLOCK_AT(offset)->size) {
+    HeapBlock *block = BLOCK_AT(offset);
+    if(block->used || block->size < need)
+      continue;
+
+    if(block->size - need >= sizeof(HeapBlock) + HEAP_ALIGN) {
+      BLOCK_AT(offset + need)->size = block->size - need;
+      BLOCK_AT(offset + need)->used = 0;
+      block->size = need;
+    }
+    block->used = 1;
+
+    s_heap_used += block->size;
+    if(s_heap_used > s_heap_peak)
+      s_heap_peak = s_heap_used;
+    s_allocations++;
+
+    memset(block + 1, 0, block->size - sizeof(HeapBlock));
+    heap_track();
+    return block + 1;
+  }
+
+  die("out of heap allocating %u bytes for %s (%u used)", (unsigned) size, what, (unsigned) s_heap_used);
+  return NULL;
+}
+
+static void heap_free(void *pointer) {
+  HeapBlock *block = (HeapBlock*) pointer - 1;
+  if(!block->used)
+    die("double free");
+
+  block->used = 0;
+  s_heap_used -= block->size;
+  memset(pointer, 0xDD, block->size - sizeof(HeapBlock));
+
+  // Merge neighbouring holes
+  for(size_t offset = 0; offset < HEAP_SIZE; offset += BLOCK_AT(offset)->size) {
+    HeapBlock *hole = BLOCK_AT(offset);
+    while(!hole->used && offset + hole->size < HEAP_SIZE && !BLOCK_AT(offset + hole->size)->used)
+      hole->size += BLOCK_AT(offset + hole->size)->size;
+  }
+  heap_track();
+}
+
+// Remember the worst layout seen
+static void heap_track() {
+  PblHeapStats stats;
+  pbl_heap_stats(&stats);
+
+  size_t free_bytes = stats.size - stats.used;
+  uint16_t fragmentation = free_bytes ? (free_bytes - stats.largest_free) * 1000 / free_bytes : 0;
+  if(fragmentation > s_worst_fragmentation)
+    s_worst_fragmentation = fragmentation;
+  if(stats.free_blocks > s_worst_free_blocks)
+    s_worst_free_blocks = stats.free_blocks;
+}
+
+// Every object starts with its magic, poisoned once freed
+static void check(const void *object, uint32_t magic, const char *function) {
+  if(!object)
+    die("%s: NULL object", function);
+  if(*(const uint32_t*) object != magic)
+    die("%s: object was destroyed or is of the wrong type", function);
+}
+
+void pbl_heap_stats(PblHeapStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->size = HEAP_SIZE;
+  stats->used = s_heap_used;
+  stats->peak = s_heap_peak;
+  stats->allocations = s_allocations;
+  stats->worst_free_blocks = s_worst_free_blocks;
+  stats->worst_fragmentation = s_worst_fragmentation;
+  stats->largest_free = s_heap_ready ? 0 : HEAP_SIZE;
+
+  for(size_t offset = 0; s_heap_ready && offset < HEAP_SIZE; offset += BLOCK_AT(offset)->size) {
+    HeapBlock *block = BLOCK_AT(offset);
+    if(block->used)
+      continue;
+    stats->free_blocks++;
+    if(block->size > stats->largest_free)
+      stats->largest_free = block->size;
+  }
+}
+
+size_t heap_bytes_used(void) {
+  return s_heap_used;
+}
+
+size_t heap_bytes_free(void) {
+  return HEAP_SIZE - s_heap_used;
+}
+
+/********************/
+/*     LOGGING      */
+/********************/
+
+// Silent unless PBL_LOG is set to a level, e.g. PBL_LOG=200 for debug
+void app_log(uint8_t level, const char *file, int line, const char *format, ...) {
+  if(s_log_level < 0) {
+    const char *setting = getenv("PBL_LOG");
+    s_log_level = setting ? atoi(setting) : APP_LOG_LEVEL_ERROR;
+  }
+  if(level > s_log_level)
+    return;
+
+  va_list args;
+  va_start(args, format);
+  printf("[%s:%d] ", file, line);
+  vprintf(format, args);
+  printf("\n");
+  va_end(args);
+}
+
+/********************/
+/*     GRAPHICS     */
+/********************/
+
+void gpath_move_to(GPath *path, GPoint point) {
+  path->offset = point;
+}
+
+void gpath_draw_filled(GContext *ctx, GPath *path) {}
+void gpath_draw_outline(GContext *ctx, GPath *path) {}
+void graphics_draw_line(GContext *ctx, GPoint from, GPoint to) {}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke = color;
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t width) {
+  ctx->stroke_width = width;
+}
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource) {
+  GBitmap *bitmap = heap_alloc(sizeof(GBitmap), "GBitmap");
+  bitmap->magic = MAGIC_BITMAP;
+  bitmap->resource = resource;
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  check(bitmap, MAGIC_BITMAP, __func__);
+  heap_free(bitmap);
+}
+
+GFont fonts_get_system_font(const char *key) {
+  return key;
+}
+
+/********************/
+/*      LAYERS      */
+/********************/
+
+static void layer_init(Layer *layer, GRect frame) {
+  layer->magic = MAGIC_LAYER;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+}
+
+static void layer_deinit(Layer *layer) {
+  layer_remove_from_parent(layer);
+  for(Layer *child = layer->first_child; child; child = child->next_sibling)
+    child->parent = NULL;
+  layer->first_child = NULL;
+}
+
+Layer* layer_create(GRect frame) {
+  Layer *layer = heap_alloc(sizeof(Layer), "Layer");
+  layer_init(layer, frame);
+  return layer;
+}
+
+void layer_destroy(Layer *layer) {
+  check(layer, MAGIC_LAYER, __func__);
+  layer_deinit(layer);
+  heap_free(layer);
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  check(layer, MAGIC_LAYER, __func__);
+  return layer->bounds;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  check(layer, MAGIC_LAYER, __func__);
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  check(parent, MAGIC_LAYER, __func__);
+  check(child, MAGIC_LAYER, __func__);
+  layer_remove_from_parent(child);
+
+  Layer **link = &parent->first_child;
+  while(*link)
+    link = &(*link)->next_sibling;
+  *link = child;
+  child->parent = parent;
+  parent->dirty = true;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  check(child, MAGIC_LAYER, __func__);
+  if(!child->parent)
+    return;
+
+  check(child->parent, MAGIC_LAYER, __func__);
+  for(Layer **link = &child->parent->first_child; *link; link = &(*link)->next_sibling) {
+    if(*link == child) {
+      *link = child->next_sibling;
+      break;
+    }
+  }
+  child->parent->dirty = true;
+  child->parent = NULL;
+  child->next_sibling = NULL;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  check(layer, MAGIC_LAYER, __func__);
+  layer->dirty = true;
+}
+
+TextLayer* text_layer_create(GRect frame) {
+  TextLayer *text_layer = heap_alloc(sizeof(TextLayer), "TextLayer");
+  text_layer->magic = MAGIC_TEXT;
+  layer_init(&text_layer->layer, frame);
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  layer_deinit(&text_layer->layer);
+  heap_free(text_layer);
+}
+
+Layer* text_layer_get_layer(TextLayer *text_layer) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  text_layer->text = text;
+  text_layer->layer.dirty = true;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment alignment) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  text_layer->alignment = alignment;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  text_layer->font = font;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  check(text_layer, MAGIC_TEXT, __func__);
+  text_layer->background = color;
+}
+
+/********************/
+/*     WINDOWS      */
+/********************/
+
+Window* window_create(void) {
+  Window *window = heap_alloc(sizeof(Window), "Window");
+  window->magic = MAGIC_WINDOW;
+  layer_init(&window->root, GRect(0, 0, 144, 168));
+  window->background = GColorWhite;
+  return window;
+}
+
+// Destroying a window that is still shown removes it first
+void window_destroy(Window *window) {
+  check(window, MAGIC_WINDOW, __func__);
+  window_stack_remove(window, false);
+  layer_deinit(&window->root);
+  heap_free(window);
+}
+
+Layer* window_get_root_layer(const Window *window) {
+  check(window, MAGIC_WINDOW, __func__);
+  return (Layer*) &window->root;
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  check(window, MAGIC_WINDOW, __func__);
+  window->handlers = handlers;
+}
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider provider) {
+  check(window, MAGIC_WINDOW, __func__);
+  window->click_config = provider;
+}
+
+void window_set_background_color(Window *window, GColor color) {
+  check(window, MAGIC_WINDOW, __func__);
+  window->background = color;
+}
+
+void window_single_click_subscribe(ButtonId button, ClickHandler handler) {
+  if(!s_click_window)
+    die("%s: called outside of a click config provider", __func__);
+  s_click_window->clicks[button] = handler;
+}
+
+void window_long_click_subscribe(ButtonId button, uint16_t delay_ms, ClickHandler down, ClickHandler up) {}
+
+void window_stack_push(Window *window, bool animated) {
+  check(window, MAGIC_WINDOW, __func__);
+  if(s_stack_count == ARRAY_LENGTH(s_stack))
+    die("%s: window stack full", __func__);
+
+  s_stack[s_stack_count++] = window;
+  pbl_counters.window_pushes++;
+  if(!window->loaded) {
+    window->loaded = true;
+    if(window->handlers.load)
+      window->handlers.load(window);
+  }
+  if(window->handlers.appear)
+    window->handlers.appear(window);
+  window->root.dirty = true;
+}
+
+// Unload may destroy the window, so it is not touched afterwards
+bool window_stack_remove(Window *window, bool animated) {
+  check(window, MAGIC_WINDOW, __func__);
+
+  uint8_t i = 0;
+  while(i < s_stack_count && s_stack[i] != window)
+    i++;
+  if(i == s_stack_count)
+    return false;
+
+  memmove(&s_stack[i], &s_stack[i + 1], (s_stack_count - i - 1) * sizeof(Window*));
+  s_stack_count--;
+  if(s_stack_count > 0)
+    s_stack[s_stack_count - 1]->root.dirty = true;
+
+  if(window->handlers.disappear)
+    window->handlers.disappear(window);
+  window->loaded = false;
+  if(window->handlers.unload)
+    window->handlers.unload(window);
+  return true;
+}
+
+Window* window_stack_pop(bool animated) {
+  if(s_stack_count == 0)
+    return NULL;
+  Window *window = s_stack[s_stack_count - 1];
+  window_stack_remove(window, animated);
+  return window;
+}
+
+void window_stack_pop_all(bool animated) {
+  while(s_stack_count > 0)
+    window_stack_pop(animated);
+}
+
+ActionBarLayer* action_bar_layer_create(void) {
+  ActionBarLayer *action_bar = heap_alloc(sizeof(ActionBarLayer), "ActionBarLayer");
+  action_bar->magic = MAGIC_ACTION;
+  layer_init(&action_bar->layer, GRect(114, 0, 30, 168));
+  return action_bar;
+}
+
+void action_bar_layer_destroy(ActionBarLayer *action_bar) {
+  check(action_bar, MAGIC_ACTION, __func__);
+  if(action_bar->window)
+    action_bar_layer_remove_from_window(action_bar);
+  layer_deinit(&action_bar->layer);
+  heap_free(action_bar);
+}
+
+void action_bar_layer_add_to_window(ActionBarLayer *action_bar, Window *window) {
+  check(action_bar, MAGIC_ACTION, __func__);
+  check(window, MAGIC_WINDOW, __func__);
+  layer_add_child(&window->root, &action_bar->layer);
+  action_bar->window = window;
+  window->action_bar = action_bar;
+}
+
+void action_bar_layer_remove_from_window(ActionBarLayer *action_bar) {
+  check(action_bar, MAGIC_ACTION, __func__);
+  if(!action_bar->window)
+    return;
+  check(action_bar->window, MAGIC_WINDOW, __func__);
+  layer_remove_from_parent(&action_bar->layer);
+  action_bar->window->action_bar = NULL;
+  action_bar->window = NULL;
+}
+
+void action_bar_layer_set_click_config_provider(ActionBarLayer *action_bar, ClickConfigProvider provider) {
+  check(action_bar, MAGIC_ACTION, __func__);
+  action_bar->click_config = provider;
+}
+
+void action_bar_layer_set_icon(ActionBarLayer *action_bar, ButtonId button, const GBitmap *icon) {
+  check(action_bar, MAGIC_ACTION, __func__);
+  check(icon, MAGIC_BITMAP, __func__);
+  action_bar->icons[button] = icon;
+  action_bar->layer.dirty = true;
+}
+
+/********************/
+/*       MENU       */
+/********************/
+
+MenuLayer* menu_layer_create(GRect frame) {
+  MenuLayer *menu_layer = heap_alloc(sizeof(MenuLayer), "MenuLayer");
+  menu_layer->magic = MAGIC_MENU;
+  layer_init(&menu_layer->layer, frame);
+  menu_layer->layer.menu = menu_layer;
+  s_menu = menu_layer;
+  return menu_layer;
+}
+
+void menu_layer_destroy(MenuLayer *menu_layer) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  if(s_menu == menu_layer)
+    s_menu = NULL;
+  layer_deinit(&menu_layer->layer);
+  heap_free(menu_layer);
+}
+
+Layer* menu_layer_get_layer(const MenuLayer *menu_layer) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  return (Layer*) &menu_layer->layer;
+}
+
+void menu_layer_set_callbacks(MenuLayer *menu_layer, void *context, MenuLayerCallbacks callbacks) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  menu_layer->callbacks = callbacks;
+  menu_layer->context = context;
+}
+
+void menu_layer_set_click_config_onto_window(MenuLayer *menu_layer, Window *window) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  check(window, MAGIC_WINDOW, __func__);
+}
+
+void menu_layer_set_highlight_colors(MenuLayer *menu_layer, GColor background, GColor foreground) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  menu_layer->highlight[0] = background;
+  menu_layer->highlight[1] = foreground;
+}
+
+void menu_layer_reload_data(MenuLayer *menu_layer) {
+  check(menu_layer, MAGIC_MENU, __func__);
+  menu_layer->layer.dirty = true;
+  pbl_counters.menu_reloads++;
+}
+
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title, const char *subtitle, GBitmap *icon) {}
+
+// Draw every row, like a full screen of cells
+static void menu_layer_draw(MenuLayer *menu_layer) {
+  MenuLayerCallbacks *callbacks = &menu_layer->callbacks;
+  uint16_t rows = callbacks->get_num_rows(menu_layer, 0, menu_layer->context);
+  for(uint16_t row = 0; row < rows; row++) {
+    MenuIndex index = {0, row};
+    callbacks->draw_row(&s_context, &menu_layer->layer, &index, menu_layer->context);
+  }
+}
+
+/********************/
+/*      TIMERS      */
+/********************/
+
+time_t pbl_override_time(time_t *result) {
+  time_t now = s_now_ms / 1000;
+  if(result)
+    *result = now;
+  return now;
+}
+
+uint16_t time_ms(time_t *seconds, uint16_t *milliseconds) {
+  uint16_t ms = s_now_ms % 1000;
+  if(seconds)
+    *seconds = s_now_ms / 1000;
+  if(milliseconds)
+    *milliseconds = ms;
+  return ms;
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *data) {
+  AppTimer *timer = heap_alloc(sizeof(AppTimer), "AppTimer");
+  timer->magic = MAGIC_TIMER;
+  timer->fire_ms = s_now_ms + timeout_ms;
+  timer->callback = callback;
+  timer->data = data;
+  timer->next = s_timers;
+  s_timers = timer;
+  return timer;
+}
+
+static AppTimer** timer_find(AppTimer *timer) {
+  AppTimer **link = &s_timers;
+  while(*link && *link != timer)
+    link = &(*link)->next;
+  return *link ? link : NULL;
+}
+
+// Handles of fired timers are harmless, as on the watch
+bool app_timer_reschedule(AppTimer *timer, uint32_t timeout_ms) {
+  if(!timer_find(timer))
+    return false;
+  timer->fire_ms = s_now_ms + timeout_ms;
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer) {
+  AppTimer **link = timer_find(timer);
+  if(!link)
+    return;
+  *link = timer->next;
+  heap_free(timer);
+}
+
+/********************/
+/*    ANIMATION     */
+/********************/
+
+Animation* animation_create(void) {
+  Animation *animation = heap_alloc(sizeof(Animation), "Animation");
+  animation->magic = MAGIC_ANIMATION;
+  animation->duration = 250;
+  return animation;
+}
+
+bool animation_set_duration(Animation *animation, uint32_t duration_ms) {
+  check(animation, MAGIC_ANIMATION, __func__);
+  animation->duration = duration_ms;
+  return true;
+}
+
+bool animation_set_implementation(Animation *animation, const AnimationImplementation *implementation) {
+  check(animation, MAGIC_ANIMATION, __func__);
+  animation->implementation = implementation;
+  return true;
+}
+
+bool animation_set_handlers(Animation *animation, AnimationHandlers handlers, void *context) {
+  check(animation, MAGIC_ANIMATION, __func__);
+  animation->handlers = handlers;
+  animation->context = context;
+  return true;
+}
+
+bool animation_schedule(Animation *animation) {
+  check(animation, MAGIC_ANIMATION, __func__);
+  animation->start_ms = s_now_ms;
+  animation->next = s_animations;
+  s_animations = animation;
+
+  if(animation->implementation && animation->implementation->setup)
+    animation->implementation->setup(animation);
+  if(animation->handlers.started)
+    animation->handlers.started(animation, animation->context);
+  return true;
+}
+
+// Stopped animations are destroyed, as with SDK 3
+static bool animation_finish(Animation *animation, bool finished) {
+  Animation **link = &s_animations;
+  while(*link && *link != animation)
+    link = &(*link)->next;
+  if(!*link)
+    return false;
+  *link = animation->next;
+
+  if(animation->handlers.stopped)
+    animation->handlers.stopped(animation, finished, animation->context);
+  if(animation->implementation && animation->implementation->teardown)
+    animation->implementation->teardown(animation);
+  heap_free(animation);
+  return true;
+}
+
+bool animation_unschedule(Animation *animation) {
+  return animation_finish(animation, false);
+}
+
+static void animation_frame() {
+  Animation *frame[8];
+  uint8_t count = 0;
+  for(Animation *animation = s_animations; animation && count < ARRAY_LENGTH(frame); animation = animation->next)
+    frame[count++] = animation;
+
+  for(uint8_t i = 0; i < count; i++) {
+    // An earlier update may have stopped this one
+    Animation *animation = s_animations;
+    while(animation && animation != frame[i])
+      animation = animation->next;
+    if(!animation)
+      continue;
+
+    uint64_t elapsed = s_now_ms - animation->start_ms;
+    bool done = animation->duration != ANIMATION_DURATION_INFINITE && elapsed >= animation->duration;
+    AnimationProgress progress = 0;
+    if(done)
+      progress = ANIMATION_NORMALIZED_MAX;
+    else if(animation->duration != ANIMATION_DURATION_INFINITE)
+      progress = elapsed * ANIMATION_NORMALIZED_MAX / animation->duration;
+
+    if(animation->implementation && animation->implementation->update)
+      animation->implementation->update(animation, progress);
+    if(done)
+      animation_finish(animation, true);
+  }
+}
+
+/********************/
+/*     SERVICES     */
+/********************/
+
+BatteryChargeState battery_state_service_peek(void) {
+  return s_battery;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  s_battery_handler = NULL;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  s_tap_handler = NULL;
+}
+
+void vibes_short_pulse(void) {
+  pbl_counters.vibes++;
+}
+
+void vibes_long_pulse(void) {
+  pbl_counters.vibes++;
+}
+
+void vibes_double_pulse(void) {
+  pbl_counters.vibes++;
+}
+
+/********************/
+/*     STORAGE      */
+/********************/
+
+static PersistEntry* persist_entry(uint32_t key) {
+  if(key >= ARRAY_LENGTH(s_persist))
+    die("persist key %u out of range", (unsigned) key);
+  return &s_persist[key];
+}
+
+bool persist_exists(uint32_t key) {
+  return persist_entry(key)->exists;
+}
+
+int persist_delete(uint32_t key) {
+  persist_entry(key)->exists = false;
+  return 0;
+}
+
+int32_t persist_read_int(uint32_t key) {
+  int32_t value = 0;
+  PersistEntry *entry = persist_entry(key);
+  if(entry->exists)
+    memcpy(&value, entry->data, sizeof(value));
+  return value;
+}
+
+int persist_write_int(uint32_t key, int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_read_data(uint32_t key, void *buffer, size_t size) {
+  PersistEntry *entry = persist_entry(key);
+  if(!entry->exists)
+    return -4; // E_DOES_NOT_EXIST
+  size_t length = entry->length < size ? entry->length : size;
+  memcpy(buffer, entry->data, length);
+  return length;
+}
+
+int persist_write_data(uint32_t key, const void *data, size_t size) {
+  PersistEntry *entry = persist_entry(key);
+  if(size > PERSIST_DATA_MAX_LENGTH)
+    size = PERSIST_DATA_MAX_LENGTH;
+  entry->exists = true;
+  entry->length = size;
+  memcpy(entry->data, data, size);
+
+  pbl_counters.persist_writes++;
+  pbl_counters.persist_bytes += size;
+  return size;
+}
+
+/********************/
+/*      WAKEUP      */
+/********************/
+
+WakeupId wakeup_schedule(time_t timestamp, int32_t reason, bool notify_if_missed) {
+  for(uint8_t i = 0; i < ARRAY_LENGTH(s_wakeups); i++) {
+    if(s_wakeups[i].id == 0) {
+      s_wakeups[i] = (WakeupEntry){s_next_wakeup_id++, timestamp, reason};
+      return s_wakeups[i].id;
+    }
+  }
+  return -8; // E_RANGE
+}
+
+static WakeupEntry* wakeup_find(WakeupId id) {
+  for(uint8_t i = 0; id > 0 && i < ARRAY_LENGTH(s_wakeups); i++) {
+    if(s_wakeups[i].id == id)
+      return &s_wakeups[i];
+  }
+  return NULL;
+}
+
+bool wakeup_query(WakeupId id, time_t *timestamp) {
+  WakeupEntry *entry = wakeup_find(id);
+  if(entry && timestamp)
+    *timestamp = entry->timestamp;
+  return entry != NULL;
+}
+
+void wakeup_cancel(WakeupId id) {
+  WakeupEntry *entry = wakeup_find(id);
+  if(entry)
+    entry->id = 0;
+}
+
+bool wakeup_get_launch_event(WakeupId *id, int32_t *reason) {
+  return false;
+}
+
+void wakeup_service_subscribe(WakeupHandler handler) {
+  s_wakeup_handler = handler;
+}
+
+AppLaunchReason launch_reason(void) {
+  return s_launch_reason;
+}
+
+/********************/
+/*    APPMESSAGE    */
+/********************/
+
+Tuple* dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  uint8_t count = iter->buffer[0];
+  uint8_t *cursor = iter->buffer + 1;
+  for(uint8_t i = 0; i < count; i++) {
+    Tuple *tuple = (Tuple*) cursor;
+    if(tuple->key == key)
+      return tuple;
+    cursor += sizeof(Tuple) + tuple->length;
+  }
+  return NULL;
+}
+
+uint32_t dict_size(DictionaryIterator *iter) {
+  return iter->size;
+}
+
+AppMessageResult app_message_open(const uint32_t inbox_size, const uint32_t outbox_size) {
+  s_inbox_size = inbox_size;
+  return APP_MSG_OK;
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived handler) {
+  s_inbox_handler = handler;
+}
+
+/********************/
+/*      WORKER      */
+/********************/
+
+bool app_worker_is_running(void) {
+  return s_worker_running;
+}
+
+AppWorkerResult app_worker_launch(void) {
+  if(!s_worker_available)
+    return APP_WORKER_RESULT_NO_WORKER;
+  if(s_worker_running)
+    return APP_WORKER_RESULT_ALREADY_RUNNING;
+
+  s_worker_running = true;
+  if(s_worker_hook)
+    s_worker_hook(PBL_WORKER_LAUNCHED, NULL);
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+AppWorkerResult app_worker_kill(void) {
+  if(!s_worker_running)
+    return APP_WORKER_RESULT_NOT_RUNNING;
+  s_worker_running = false;
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler) {
+  s_worker_handler = handler;
+  return true;
+}
+
+bool app_worker_message_unsubscribe(void) {
+  s_worker_handler = NULL;
+  return true;
+}
+
+void app_worker_send_message(uint8_t type, AppWorkerMessage *message) {
+  pbl_counters.worker_messages++;
+  if(s_worker_running && s_worker_hook)
+    s_worker_hook(type, message);
+}
+
+/********************/
+/*    EVENT LOOP    */
+/********************/
+
+void app_event_loop(void) {
+  render();
+  pbl_scenario();
+}
+
+// Redraw the top window if anything in it changed
+static bool layer_tree_dirty(Layer *layer) {
+  for(; layer; layer = layer->next_sibling) {
+    if(layer->dirty || layer_tree_dirty(layer->first_child))
+      return true;
+  }
+  return false;
+}
+
+static void layer_tree_draw(Layer *layer) {
+  for(; layer; layer = layer->next_sibling) {
+    layer->dirty = false;
+    if(layer->menu)
+      menu_layer_draw(layer->menu);
+    else if(layer->update_proc)
+      layer->update_proc(layer, &s_context);
+    layer_tree_draw(layer->first_child);
+  }
+}
+
+static void render() {
+  if(s_stack_count == 0)
+    return;
+
+  Layer *root = &s_stack[s_stack_count - 1]->root;
+  if(!root->dirty && !layer_tree_dirty(root->first_child))
+    return;
+
+  root->dirty = false;
+  layer_tree_draw(root->first_child);
+  pbl_counters.frames++;
+}
+
+// Dispatch everything due within the next milliseconds, in time order.
+// Returns early once the window stack is empty, as the app would exit.
+void pbl_run(uint32_t duration_ms) {
+  uint64_t end_ms = s_now_ms + duration_ms;
+
+  while(s_stack_count > 0) {
+    uint64_t next_ms = end_ms;
+    AppTimer *timer = NULL;
+    WakeupEntry *wakeup = NULL;
+    bool frame = false;
+
+    // Newest timers come first, so ties go to the one registered first
+    for(AppTimer *candidate = s_timers; candidate; candidate = candidate->next) {
+      if(candidate->fire_ms <= next_ms) {
+        next_ms = candidate->fire_ms;
+        timer = candidate;
+      }
+    }
+    for(uint8_t i = 0; s_wakeup_handler && i < ARRAY_LENGTH(s_wakeups); i++) {
+      uint64_t wakeup_ms = (uint64_t) s_wakeups[i].timestamp * 1000;
+      if(s_wakeups[i].id != 0 && wakeup_ms < next_ms) {
+        next_ms = wakeup_ms;
+        wakeup = &s_wakeups[i];
+        timer = NULL;
+      }
+    }
+    if(s_animations) {
+      uint64_t frame_ms = s_last_frame_ms + FRAME_MS;
+      if(frame_ms < s_now_ms)
+        frame_ms = s_now_ms;
+      if(frame_ms < next_ms) {
+        next_ms = frame_ms;
+        frame = true;
+        timer = NULL;
+        wakeup = NULL;
+      }
+    }
+    if(s_worker_queued > 0 && s_worker_handler) {
+      next_ms = s_now_ms;
+      timer = NULL;
+      wakeup = NULL;
+      frame = false;
+    }
+
+    if(next_ms > s_now_ms)
+      s_now_ms = next_ms;
+
+    if(timer) {
+      AppTimerCallback callback = timer->callback;
+      void *data = timer->data;
+      *timer_find(timer) = timer->next;
+      heap_free(timer);
+      callback(data);
+    }
+    else if(wakeup) {
+      WakeupEntry fired = *wakeup;
+      wakeup->id = 0;
+      s_wakeup_handler(fired.id, fired.reason);
+    }
+    else if(frame) {
+      s_last_frame_ms = s_now_ms;
+      animation_frame();
+    }
+    else if(s_worker_queued > 0 && s_worker_handler) {
+      uint16_t type = s_worker_queue[0].type;
+      AppWorkerMessage message = s_worker_queue[0].message;
+      memmove(&s_worker_queue[0], &s_worker_queue[1], --s_worker_queued * sizeof(s_worker_queue[0]));
+      s_worker_handler(type, &message);
+    }
+    else
+      break;
+
+    render();
+  }
+
+  if(s_now_ms < end_ms)
+    s_now_ms = end_ms;
+}
+
+/********************/
+/*     HARNESS      */
+/********************/
+
+// Forget the previous launch, storage and wakeups survive it
+void pbl_reset(AppLaunchReason reason) {
+  if(s_stack_count > 0 || s_timers || s_animations)
+    die("%s: previous launch not cleaned up", __func__);
+
+  s_launch_reason = reason;
+  s_battery_handler = NULL;
+  s_tap_handler = NULL;
+  s_wakeup_handler = NULL;
+  s_inbox_handler = NULL;
+  s_inbox_size = 0;
+  s_worker_handler = NULL;
+  s_worker_queued = 0;
+  s_menu = NULL;
+}
+
+// What the firmware does once main() returns: timers and animations are
+// stopped, and the whole heap is reclaimed without calling the app. Returns
+// how much the app itself left allocated, windows still shown included.
+size_t pbl_exit(void) {
+  while(s_timers) {
+    AppTimer *timer = s_timers;
+    s_timers = timer->next;
+    heap_free(timer);
+  }
+  while(s_animations) {
+    Animation *animation = s_animations;
+    s_animations = animation->next;
+    heap_free(animation);
+  }
+  s_stack_count = 0;
+
+  size_t left = s_heap_used;
+  s_heap_ready = false;
+  s_heap_used = 0;
+  return left;
+}
+
+void pbl_set_battery(uint8_t charge_percent, bool plugged) {
+  s_battery = (BatteryChargeState){charge_percent, plugged, plugged};
+  if(s_battery_handler)
+    s_battery_handler(s_battery);
+}
+
+// Click on the top window, back pops it when nothing else handles it
+void pbl_press(ButtonId button) {
+  if(s_stack_count == 0)
+    return;
+
+  Window *window = s_stack[s_stack_count - 1];
+  ClickConfigProvider provider = window->action_bar ? window->action_bar->click_config : window->click_config;
+  memset(window->clicks, 0, sizeof(window->clicks));
+  s_click_window = window;
+  if(provider)
+    provider(window);
+  s_click_window = NULL;
+
+  if(window->clicks[button])
+    window->clicks[button](NULL, window);
+  else if(button == BUTTON_ID_BACK)
+    window_stack_pop(true);
+  render();
+}
+
+// Flick the wrist, false if nothing listens to the accelerometer
+bool pbl_tap(void) {
+  if(!s_tap_handler)
+    return false;
+
+  s_tap_handler(ACCEL_AXIS_Y, 1);
+  render();
+  return true;
+}
+
+// Select a row of the menu, if it is on top
+bool pbl_menu_select(uint16_t row) {
+  if(!s_menu || s_stack_count == 0 || s_menu->layer.parent != &s_stack[s_stack_count - 1]->root)
+    return false;
+
+  MenuIndex index = {0, row};
+  s_menu->callbacks.select_click(s_menu, &index, s_menu->context);
+  render();
+  return true;
+}
+
+Window* pbl_top_window(void) {
+  return s_stack_count > 0 ? s_stack[s_stack_count - 1] : NULL;
+}
+
+uint8_t pbl_stack_count(void) {
+  return s_stack_count;
+}
+
+void pbl_worker_set_available(bool available) {
+  s_worker_available = available;
+  if(!available)
+    s_worker_running = false;
+}
+
+// Queue a message from the worker, delivered by pbl_run()
+void pbl_worker_report(uint16_t type, AppWorkerMessage message) {
+  if(s_worker_queued == ARRAY_LENGTH(s_worker_queue))
+    die("%s: worker queue full", __func__);
+  s_worker_queue[s_worker_queued].type = type;
+  s_worker_queue[s_worker_queued++].message = message;
+}
+
+void pbl_on_worker_message(void (*hook)(uint8_t, AppWorkerMessage*)) {
+  s_worker_hook = hook;
+}
+
+// Send a dictionary from the phone. Returns false if the watch drops it
+// because it does not fit the inbox, like the firmware does.
+bool pbl_deliver(const PblTuple *tuples, uint8_t count, uint32_t *size) {
+  static uint8_t buffer[1024];
+  uint32_t length = 1;
+
+  buffer[0] = count;
+  for(uint8_t i = 0; i < count; i++) {
+    uint16_t value_length = tuples[i].cstring ? strlen(tuples[i].cstring) + 1 : sizeof(int32_t);
+    if(length + sizeof(Tuple) + value_length > sizeof(buffer))
+      die("%s: dictionary too large for the harness", __func__);
+
+    Tuple *tuple = (Tuple*) (buffer + length);
+    tuple->key = tuples[i].key;
+    tuple->type = tuples[i].cstring ? TUPLE_CSTRING : TUPLE_INT;
+    tuple->length = value_length;
+    if(tuples[i].cstring)
+      memcpy(tuple->value->cstring, tuples[i].cstring, value_length);
+    else
+      memcpy(tuple->value->data, &tuples[i].int32, sizeof(int32_t));
+    length += sizeof(Tuple) + value_length;
+  }
+  if(size)
+    *size = length;
+
+  if(!s_inbox_handler || length > s_inbox_size)
+    return false;
+
+  DictionaryIterator iter = {buffer, length};
+  s_inbox_handler(&iter, NULL);
+  render();
+  return true;
+}
\ No newline at end of file
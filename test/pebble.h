@@ -0,0 +1,445 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Host stand-in for the Pebble SDK, just enough of it to build and run the
+// app sources on a desktop. Objects live in a simulated app heap and time is
+// virtual, see pebble.c. The "HARNESS" section at the end is not SDK API.
+
+/********************/
+/*     PLATFORM     */
+/********************/
+
+#define PBL_COLOR
+#define PBL_RECT
+#define PBL_IF_ROUND_ELSE(if_true, if_false) (if_false)
+
+#define RESOURCE_ID_IMAGE_CROSS 1
+#define RESOURCE_ID_IMAGE_CHECK 2
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+
+#define ARRAY_LENGTH(array) (sizeof(array) / sizeof(array[0]))
+
+/********************/
+/*     LOGGING      */
+/********************/
+
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200,
+  APP_LOG_LEVEL_DEBUG_VERBOSE = 255
+} AppLogLevel;
+
+void app_log(uint8_t, const char*, int, const char*, ...);
+#define APP_LOG(level, ...) app_log(level, __FILE__, __LINE__, __VA_ARGS__)
+
+/********************/
+/*     GRAPHICS     */
+/********************/
+
+typedef struct { int16_t x, y; } GPoint;
+typedef struct { int16_t w, h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+typedef union { uint8_t argb; } GColor;
+typedef struct GContext GContext;
+typedef struct GBitmap GBitmap;
+typedef const char *GFont;
+
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+
+#define GColorClear         ((GColor){.argb = 0x00})
+#define GColorBlack         ((GColor){.argb = 0xC0})
+#define GColorDukeBlue      ((GColor){.argb = 0xC2})
+#define GColorDarkGray      ((GColor){.argb = 0xD5})
+#define GColorVividCerulean ((GColor){.argb = 0xCB})
+#define GColorGreen         ((GColor){.argb = 0xCC})
+#define GColorLightGray     ((GColor){.argb = 0xEA})
+#define GColorOrange        ((GColor){.argb = 0xF8})
+#define GColorWhite         ((GColor){.argb = 0xFF})
+
+typedef struct {
+  uint32_t num_points;
+  GPoint *points;
+} GPathInfo;
+
+typedef struct GPath {
+  uint32_t num_points;
+  GPoint *points;
+  int32_t rotation;
+  GPoint offset;
+} GPath;
+
+void gpath_move_to(GPath*, GPoint);
+void gpath_draw_filled(GContext*, GPath*);
+void gpath_draw_outline(GContext*, GPath*);
+void graphics_context_set_fill_color(GContext*, GColor);
+void graphics_context_set_stroke_color(GContext*, GColor);
+void graphics_context_set_stroke_width(GContext*, uint8_t);
+void graphics_draw_line(GContext*, GPoint, GPoint);
+
+GBitmap* gbitmap_create_with_resource(uint32_t);
+void gbitmap_destroy(GBitmap*);
+GFont fonts_get_system_font(const char*);
+
+/********************/
+/*      LAYERS      */
+/********************/
+
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef struct TextLayer TextLayer;
+typedef struct ActionBarLayer ActionBarLayer;
+typedef struct MenuLayer MenuLayer;
+
+typedef enum {
+  GTextAlignmentLeft,
+  GTextAlignmentCenter,
+  GTextAlignmentRight
+} GTextAlignment;
+
+typedef void (*LayerUpdateProc)(Layer*, GContext*);
+
+Layer* layer_create(GRect);
+void layer_destroy(Layer*);
+GRect layer_get_bounds(const Layer*);
+void layer_set_update_proc(Layer*, LayerUpdateProc);
+void layer_add_child(Layer*, Layer*);
+void layer_remove_from_parent(Layer*);
+void layer_mark_dirty(Layer*);
+
+TextLayer* text_layer_create(GRect);
+void text_layer_destroy(TextLayer*);
+Layer* text_layer_get_layer(TextLayer*);
+void text_layer_set_text(TextLayer*, const char*);
+void text_layer_set_text_alignment(TextLayer*, GTextAlignment);
+void text_layer_set_font(TextLayer*, GFont);
+void text_layer_set_background_color(TextLayer*, GColor);
+
+/********************/
+/*     WINDOWS      */
+/********************/
+
+typedef enum {
+  BUTTON_ID_BACK,
+  BUTTON_ID_UP,
+  BUTTON_ID_SELECT,
+  BUTTON_ID_DOWN,
+  NUM_BUTTONS
+} ButtonId;
+
+typedef void *ClickRecognizerRef;
+typedef void (*ClickHandler)(ClickRecognizerRef, void*);
+typedef void (*ClickConfigProvider)(void*);
+typedef void (*WindowHandler)(Window*);
+
+typedef struct {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Window* window_create(void);
+void window_destroy(Window*);
+Layer* window_get_root_layer(const Window*);
+void window_set_window_handlers(Window*, WindowHandlers);
+void window_set_click_config_provider(Window*, ClickConfigProvider);
+void window_set_background_color(Window*, GColor);
+void window_single_click_subscribe(ButtonId, ClickHandler);
+void window_long_click_subscribe(ButtonId, uint16_t, ClickHandler, ClickHandler);
+
+void window_stack_push(Window*, bool);
+Window* window_stack_pop(bool);
+void window_stack_pop_all(bool);
+bool window_stack_remove(Window*, bool);
+
+ActionBarLayer* action_bar_layer_create(void);
+void action_bar_layer_destroy(ActionBarLayer*);
+void action_bar_layer_add_to_window(ActionBarLayer*, Window*);
+void action_bar_layer_remove_from_window(ActionBarLayer*);
+void action_bar_layer_set_click_config_provider(ActionBarLayer*, ClickConfigProvider);
+void action_bar_layer_set_icon(ActionBarLayer*, ButtonId, const GBitmap*);
+
+/********************/
+/*       MENU       */
+/********************/
+
+typedef struct {
+  uint16_t section;
+  uint16_t row;
+} MenuIndex;
+
+typedef struct {
+  uint16_t (*get_num_sections)(MenuLayer*, void*);
+  uint16_t (*get_num_rows)(MenuLayer*, uint16_t, void*);
+  int16_t (*get_cell_height)(MenuLayer*, MenuIndex*, void*);
+  void (*draw_row)(GContext*, const Layer*, MenuIndex*, void*);
+  void (*select_click)(MenuLayer*, MenuIndex*, void*);
+  void (*select_long_click)(MenuLayer*, MenuIndex*, void*);
+} MenuLayerCallbacks;
+
+MenuLayer* menu_layer_create(GRect);
+void menu_layer_destroy(MenuLayer*);
+Layer* menu_layer_get_layer(const MenuLayer*);
+void menu_layer_set_callbacks(MenuLayer*, void*, MenuLayerCallbacks);
+void menu_layer_set_click_config_onto_window(MenuLayer*, Window*);
+void menu_layer_set_highlight_colors(MenuLayer*, GColor, GColor);
+void menu_layer_reload_data(MenuLayer*);
+void menu_cell_basic_draw(GContext*, const Layer*, const char*, const char*, GBitmap*);
+
+/********************/
+/*      TIMERS      */
+/********************/
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void*);
+
+AppTimer* app_timer_register(uint32_t, AppTimerCallback, void*);
+bool app_timer_reschedule(AppTimer*, uint32_t);
+void app_timer_cancel(AppTimer*);
+
+// Firmware time, virtual here
+time_t pbl_override_time(time_t*);
+#define time pbl_override_time
+uint16_t time_ms(time_t*, uint16_t*);
+
+/********************/
+/*    ANIMATION     */
+/********************/
+
+typedef struct Animation Animation;
+typedef uint32_t AnimationProgress;
+
+#define ANIMATION_NORMALIZED_MAX 65535
+#define ANIMATION_DURATION_INFINITE UINT32_MAX
+
+typedef struct {
+  void (*setup)(Animation*);
+  void (*update)(Animation*, const AnimationProgress);
+  void (*teardown)(Animation*);
+} AnimationImplementation;
+
+typedef struct {
+  void (*started)(Animation*, void*);
+  void (*stopped)(Animation*, bool, void*);
+} AnimationHandlers;
+
+Animation* animation_create(void);
+bool animation_set_duration(Animation*, uint32_t);
+bool animation_set_implementation(Animation*, const AnimationImplementation*);
+bool animation_set_handlers(Animation*, AnimationHandlers, void*);
+bool animation_schedule(Animation*);
+bool animation_unschedule(Animation*);
+
+/********************/
+/*     SERVICES     */
+/********************/
+
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+
+typedef enum {
+  ACCEL_AXIS_X,
+  ACCEL_AXIS_Y,
+  ACCEL_AXIS_Z
+} AccelAxisType;
+
+typedef void (*BatteryStateHandler)(BatteryChargeState);
+typedef void (*AccelTapHandler)(AccelAxisType, int32_t);
+
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler);
+void battery_state_service_unsubscribe(void);
+void accel_tap_service_subscribe(AccelTapHandler);
+void accel_tap_service_unsubscribe(void);
+
+void vibes_short_pulse(void);
+void vibes_long_pulse(void);
+void vibes_double_pulse(void);
+
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+/********************/
+/*     STORAGE      */
+/********************/
+
+#define PERSIST_DATA_MAX_LENGTH 256
+
+bool persist_exists(uint32_t);
+int persist_delete(uint32_t);
+int32_t persist_read_int(uint32_t);
+int persist_write_int(uint32_t, int32_t);
+int persist_read_data(uint32_t, void*, size_t);
+int persist_write_data(uint32_t, const void*, size_t);
+
+/********************/
+/*      WAKEUP      */
+/********************/
+
+typedef int32_t WakeupId;
+typedef void (*WakeupHandler)(WakeupId, int32_t);
+
+typedef enum {
+  APP_LAUNCH_SYSTEM,
+  APP_LAUNCH_USER,
+  APP_LAUNCH_PHONE,
+  APP_LAUNCH_WAKEUP,
+  APP_LAUNCH_WORKER,
+  APP_LAUNCH_QUICK_LAUNCH,
+  APP_LAUNCH_TIMELINE_ACTION,
+  APP_LAUNCH_SMARTSTRAP
+} AppLaunchReason;
+
+WakeupId wakeup_schedule(time_t, int32_t, bool);
+bool wakeup_query(WakeupId, time_t*);
+void wakeup_cancel(WakeupId);
+bool wakeup_get_launch_event(WakeupId*, int32_t*);
+void wakeup_service_subscribe(WakeupHandler);
+AppLaunchReason launch_reason(void);
+
+/********************/
+/*    APPMESSAGE    */
+/********************/
+
+#define APP_MESSAGE_INBOX_SIZE_MINIMUM 124
+
+typedef enum {
+  TUPLE_BYTE_ARRAY = 0,
+  TUPLE_CSTRING = 1,
+  TUPLE_UINT = 2,
+  TUPLE_INT = 3
+} TupleType;
+
+// Same 7 byte header as the firmware
+typedef struct __attribute__((packed)) {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+
+typedef struct {
+  uint8_t *buffer; // Tuple count, then the tuples
+  uint16_t size;
+} DictionaryIterator;
+
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_BUFFER_OVERFLOW = 128
+} AppMessageResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator*, void*);
+
+Tuple* dict_find(const DictionaryIterator*, const uint32_t);
+uint32_t dict_size(DictionaryIterator*);
+AppMessageResult app_message_open(const uint32_t, const uint32_t);
+void app_message_register_inbox_received(AppMessageInboxReceived);
+
+/********************/
+/*      WORKER      */
+/********************/
+
+typedef struct {
+  uint16_t data0;
+  uint16_t data1;
+  uint16_t data2;
+} AppWorkerMessage;
+
+typedef enum {
+  APP_WORKER_RESULT_SUCCESS = 0,
+  APP_WORKER_RESULT_NO_WORKER = 1,
+  APP_WORKER_RESULT_DIFFERENT_APP = 2,
+  APP_WORKER_RESULT_NOT_RUNNING = 3,
+  APP_WORKER_RESULT_ALREADY_RUNNING = 4,
+  APP_WORKER_RESULT_ASKING_CONFIRMATION = 5
+} AppWorkerResult;
+
+typedef void (*AppWorkerMessageHandler)(uint16_t, AppWorkerMessage*);
+
+bool app_worker_is_running(void);
+AppWorkerResult app_worker_launch(void);
+AppWorkerResult app_worker_kill(void);
+bool app_worker_message_subscribe(AppWorkerMessageHandler);
+bool app_worker_message_unsubscribe(void);
+void app_worker_send_message(uint8_t, AppWorkerMessage*);
+
+void app_event_loop(void);
+
+/********************/
+/*     HARNESS      */
+/********************/
+
+// Heap figures, in bytes of the simulated app heap. The worst_ fields are
+// kept over every allocation and free since the start.
+typedef struct {
+  size_t size;                // Whole heap
+  size_t used;                // Allocated, headers included
+  size_t peak;                // Highest used so far
+  size_t largest_free;        // Biggest single allocation still possible
+  uint16_t free_blocks;       // Number of holes
+  uint32_t allocations;       // Calls to malloc so far
+  uint16_t worst_free_blocks; // Most holes at once
+  uint16_t worst_fragmentation; // Thousandths of the free heap outside the largest hole
+} PblHeapStats;
+
+// Counters of what the app asked the firmware to do
+typedef struct {
+  uint32_t persist_writes;
+  uint32_t persist_bytes;
+  uint32_t menu_reloads;
+  uint32_t window_pushes;
+  uint32_t frames;
+  uint32_t vibes;
+  uint32_t worker_messages;
+} PblCounters;
+
+// Passed to the worker hook once app_worker_launch() starts it
+#define PBL_WORKER_LAUNCHED 0xFF
+
+// Tuple the phone sends, int32 unless a string is given
+typedef struct {
+  uint32_t key;
+  int32_t int32;
+  const char *cstring;
+} PblTuple;
+
+extern PblCounters pbl_counters;
+
+// Runs inside app_event_loop(), defined by each harness
+void pbl_scenario(void);
+
+void pbl_heap_stats(PblHeapStats*);
+void pbl_reset(AppLaunchReason);
+void pbl_set_battery(uint8_t, bool);
+void pbl_run(uint32_t);
+void pbl_press(ButtonId);
+bool pbl_tap(void);
+bool pbl_menu_select(uint16_t);
+Window* pbl_top_window(void);
+uint8_t pbl_stack_count(void);
+void pbl_worker_set_available(bool);
+void pbl_worker_report(uint16_t, AppWorkerMessage);
+void pbl_on_worker_message(void (*)(uint8_t, AppWorkerMessage*));
+bool pbl_deliver(const PblTuple*, uint8_t, uint32_t*);
+size_t pbl_exit(void);
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include <pebble.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "../src/keys.h"
+
+// Plays the phone side of a configuration sync. Builds dictionaries the way
+// app.js does on webviewclosed, replays scripted sequences into the real
+// inbox handler and reports what each one cost the watch: persist writes,
+// bytes on the air and menu reloads per sync, and the handler's own time on
+// this host. Checks the expected figures, so a regression fails the run.
+//
+// Usage: replay
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+int pebble_app_main(void);
+
+static uint8_t phone_dict(const void*, PblTuple*);
+static void sequence_start(const char*);
+static void sequence_send(const PblTuple*, uint8_t);
+static void sequence_end(int, int, int);
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+#define TEA_COUNT (PERSIST_TEA_MATCHA - PERSIST_TEA_BLACK + 1)
+
+// What the configuration page returns, see docs/tea_config_0.8.html
+typedef struct {
+  int ready;
+  int temp_unit;
+  double minutes[TEA_COUNT]; // Black to matcha, in key order
+  int show[TEA_COUNT];
+  int animate;
+} Config;
+
+static const Config s_defaults = {
+  .ready = 0,
+  .temp_unit = 0,
+  .minutes = {4, 2, 4, 4, 4, 4, 4, 4, 0.5},
+  .show = {1, 1, 1, 1, 1, 1, 1, 1, 1},
+  .animate = 0
+};
+
+// Sequence being replayed
+static struct {
+  const char *name;
+  PblCounters before;
+  int syncs;
+  int dropped;
+  uint32_t bytes;
+  uint64_t handler_us;
+} s_sequence;
+
+static bool s_failed = false;
+
+/********************/
+/*      PHONE       */
+/********************/
+
+// Same payload as app.js: one int32 per key, seconds times the show flag
+static uint8_t phone_dict(const void *data, PblTuple *tuples) {
+  const Config *config = data;
+  uint8_t count = 0;
+
+  tuples[count++] = (PblTuple){PERSIST_READY, config->ready};
+  tuples[count++] = (PblTuple){PERSIST_TEMP_UNIT, config->temp_unit};
+  for(int i = 0; i < TEA_COUNT; i++)
+    tuples[count++] = (PblTuple){PERSIST_TEA_BLACK + i, (int32_t) (config->minutes[i] * 60 + 0.5) * config->show[i]};
+  tuples[count++] = (PblTuple){PERSIST_ANIMATE, config->animate};
+  return count;
+}
+
+/********************/
+/*     SEQUENCE     */
+/********************/
+
+static uint64_t now_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void sequence_start(const char *name) {
+  memset(&s_sequence, 0, sizeof(s_sequence));
+  s_sequence.name = name;
+  s_sequence.before = pbl_counters;
+}
+
+// One sync from the phone, timing the inbox handler
+static void sequence_send(const PblTuple *tuples, uint8_t count) {
+  uint32_t size = 0;
+  uint64_t start_us = now_us();
+  bool delivered = pbl_deliver(tuples, count, &size);
+  uint64_t end_us = now_us();
+
+  s_sequence.syncs++;
+  s_sequence.bytes += size;
+  if(delivered)
+    s_sequence.handler_us += end_us - start_us;
+  else
+    s_sequence.dropped++;
+}
+
+// Report the sequence and compare its totals with what is expected
+static void sequence_end(int expect_dropped, int expect_writes, int expect_reloads) {
+  PblCounters *before = &s_sequence.before;
+  int delivered = s_sequence.syncs - s_sequence.dropped;
+  int writes = pbl_counters.persist_writes - before->persist_writes;
+  int reloads = pbl_counters.menu_reloads - before->menu_reloads;
+
+  printf("%-26s %5d %7d %9.1f %7d %8u %8d %9.2f\n", s_sequence.name, s_sequence.syncs, s_sequence.dropped,
+         (double) s_sequence.bytes / s_sequence.syncs, writes,
+         (unsigned) (pbl_counters.persist_bytes - before->persist_bytes), reloads,
+         delivered ? (double) s_sequence.handler_us / delivered : 0.0);
+
+  if(s_sequence.dropped != expect_dropped || writes != expect_writes || reloads != expect_reloads) {
+    fprintf(stderr, "replay: %s: expected %d dropped, %d writes, %d reloads\n",
+            s_sequence.name, expect_dropped, expect_writes, expect_reloads);
+    s_failed = true;
+  }
+}
+
+/********************/
+/*     SCENARIO     */
+/********************/
+
+void pbl_scenario(void) {
+  PblTuple tuples[32];
+  uint8_t count;
+  Config config = s_defaults;
+
+  printf("%-26s %5s %7s %9s %7s %8s %8s %9s\n",
+         "sequence", "syncs", "dropped", "bytes", "writes", "written", "reloads", "us/sync");
+
+  // First save on a fresh install stores every key once
+  sequence_start("first save");
+  count = phone_dict(&config, tuples);
+  sequence_send(tuples, count);
+  sequence_end(0, count, 1);
+
+  // Saving again without changes only costs the air time
+  sequence_start("rapid saves, unchanged");
+  for(int i = 0; i < 100; i++)
+    sequence_send(tuples, count);
+  sequence_end(0, 0, 0);
+
+  // Toggling one setting writes that key and reloads the menu each time
+  sequence_start("rapid saves, one change");
+  for(int i = 0; i < 100; i++) {
+    config.minutes[1] = i % 2 ? 2 : 2.5;
+    count = phone_dict(&config, tuples);
+    sequence_send(tuples, count);
+  }
+  sequence_end(0, 100, 100);
+
+  // Hiding a tea is a single write too
+  sequence_start("hide a tea");
+  config.show[4] = 0;
+  count = phone_dict(&config, tuples);
+  sequence_send(tuples, count);
+  sequence_end(0, 1, 1);
+
+  // An older phone app without the animation key leaves it alone
+  sequence_start("missing key (animate)");
+  config.ready = 3;
+  count = phone_dict(&config, tuples) - 1;
+  sequence_send(tuples, count);
+  sequence_end(0, 1, 1);
+
+  // Only the reminder, the teas are kept
+  sequence_start("missing keys (teas)");
+  tuples[0] = (PblTuple){PERSIST_READY, 1};
+  sequence_send(tuples, 1);
+  sequence_end(0, 1, 1);
+
+  // Storage lost on the watch, the phone must send everything again
+  for(uint32_t key = PERSIST_READY; key <= PERSIST_ANIMATE; key++)
+    persist_delete(key);
+  sequence_start("resend after watch reset");
+  count = phone_dict(&config, tuples);
+  sequence_send(tuples, count);
+  sequence_end(0, count, 1);
+
+  // Numbers sent as text are not settings
+  sequence_start("string value");
+  tuples[0] = (PblTuple){PERSIST_READY, 0, "2"};
+  sequence_send(tuples, 1);
+  sequence_end(0, 0, 0);
+
+  // One key more than the inbox was sized for
+  sequence_start("oversized, extra key");
+  count = phone_dict(&config, tuples);
+  tuples[count] = (PblTuple){PERSIST_ANIMATE + 1, 1};
+  sequence_send(tuples, count + 1);
+  sequence_end(1, 0, 0);
+
+  // The whole page result as one string
+  sequence_start("oversized, raw JSON");
+  tuples[0] = (PblTuple){PERSIST_READY, 0,
+    "{\"ready\":1,\"temp_unit\":0,\"black\":4,\"black_hide\":1,\"green\":2,\"green_hide\":1,"
+    "\"herbal\":4,\"herbal_hide\":1,\"mate\":4,\"mate_hide\":1,\"oolong\":4,\"oolong_hide\":1}"};
+  sequence_send(tuples, 1);
+  sequence_end(1, 0, 0);
+}
+
+/********************/
+/*       MAIN       */
+/********************/
+
+int main(int argc, char **argv) {
+  pbl_reset(APP_LAUNCH_USER);
+  pebble_app_main();
+  pbl_exit();
+  return s_failed ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include <pebble.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include "../src/keys.h"
+#include "../src/power.h"
+
+// Brews teas over and over through the real app, from the menu through
+// steeping, cooling and done, and checks that the countdown resources are
+// reused: heap use must come back to the same level after every cancelled
+// brew and to zero once the app closes itself. Every few launches the app
+// is closed with a countdown on screen, sometimes before the worker has
+// reported in, which must only leave the menu behind and keep the brew
+// going. Every few others start by quick launch, which must brew the
+// last tea without the menu. Reports peak heap use and fragmentation.
+//
+// Usage: stress [launches]
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+int pebble_app_main(void);
+
+static void fail(const char*, ...);
+static void worker_hook(uint8_t, AppWorkerMessage*);
+static void worker_poll();
+static void run(uint32_t);
+static bool closing();
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+#define CANCELLED_BREWS 4 // Per launch, before the brew that runs to the end
+#define CLOSE_EVERY     7 // Launches closed with a countdown on screen
+#define QUICK_LAUNCH    3 // Launch in every CLOSE_EVERY started by quick launch
+#define TAP_EVERY_MS    (45 * 1000)
+#define MAX_BREW_MS     (3 * 60 * 60 * 1000)
+
+static int s_launch = 0;
+static int s_brews = 0;
+static size_t s_menu_heap = 0;
+static size_t s_closed_heap = 0;
+
+// Stand-in for worker_src, reporting like it does
+static struct {
+  uint8_t count_mode;
+  time_t end_time;
+  uint16_t duration;
+  uint16_t cool_delay;
+  uint8_t tea;
+  bool alert;
+} s_worker = {WORKER_MODE_IDLE};
+
+/********************/
+/*     FAILURES     */
+/********************/
+
+static void fail(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "stress: launch %d: ", s_launch);
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(1);
+}
+
+/********************/
+/*      WORKER      */
+/********************/
+
+static void worker_report() {
+  time_t now = time(NULL);
+  pbl_worker_report(WORKER_BREW_STATE, (AppWorkerMessage){
+    .data0 = s_worker.count_mode | (s_worker.tea << 4) | (s_worker.alert ? 0x100 : 0),
+    .data1 = s_worker.duration,
+    .data2 = s_worker.end_time > now ? s_worker.end_time - now : 0
+  });
+}
+
+static void worker_hook(uint8_t type, AppWorkerMessage *message) {
+  AppWorkerMessage start;
+  
+  switch(type) {
+    case PBL_WORKER_LAUNCHED:
+      s_worker.count_mode = WORKER_MODE_IDLE;
+      s_worker.alert = false;
+      
+      // Start the brew left in storage, like worker_init()
+      if(persist_read_data(PERSIST_BREW_START, &start, sizeof(start)) == sizeof(start)) {
+        persist_delete(PERSIST_BREW_START);
+        worker_hook(WORKER_BREW_START, &start);
+        return;
+      }
+      break;
+    case WORKER_BREW_START:
+      s_worker.count_mode = 0;
+      s_worker.tea = message->data0;
+      s_worker.duration = message->data1;
+      s_worker.cool_delay = message->data2;
+      s_worker.end_time = time(NULL) + message->data1;
+      s_worker.alert = false;
+      break;
+    case WORKER_BREW_CANCEL:
+      s_worker.count_mode = WORKER_MODE_IDLE;
+      break;
+    case WORKER_BREW_ACK:
+      s_worker.alert = false;
+      if(s_worker.count_mode != 2)
+        return;
+      s_worker.count_mode = WORKER_MODE_IDLE;
+      break;
+  }
+  worker_report();
+}
+
+// Move to the next phase once the current one is over
+static void worker_poll() {
+  if(!app_worker_is_running() || s_worker.count_mode >= 2 || time(NULL) < s_worker.end_time)
+    return;
+
+  s_worker.alert = true;
+  if(s_worker.count_mode == 0 && s_worker.cool_delay > 0) {
+    s_worker.count_mode = 1;
+    s_worker.duration = s_worker.cool_delay;
+  }
+  else {
+    s_worker.count_mode = 2;
+    s_worker.duration = 0;
+  }
+  s_worker.end_time = time(NULL) + s_worker.duration;
+  worker_report();
+}
+
+/********************/
+/*     SCENARIO     */
+/********************/
+
+// Launch closed with a countdown on screen
+static bool closing() {
+  return s_launch % CLOSE_EVERY == CLOSE_EVERY - 1;
+}
+
+// Run in one second steps, flicking the wrist now and then
+static void run(uint32_t duration_ms) {
+  for(uint32_t elapsed = 0; elapsed < duration_ms && pbl_stack_count() > 0; elapsed += 1000) {
+    pbl_run(1000);
+    worker_poll();
+
+    // The accelerometer stays off unless the power profile animates
+    if(elapsed % TAP_EVERY_MS == 2000 && pbl_tap() && !power_get_profile()->animate)
+      fail("taps listened to on a profile without animation");
+  }
+}
+
+void pbl_scenario(void) {
+  pbl_run(0);
+  
+  // Quick launch brews the last tea without the menu and stays open
+  if(launch_reason() == APP_LAUNCH_QUICK_LAUNCH) {
+    worker_poll();
+    s_brews++;
+    
+    int tea = persist_read_int(PERSIST_LAST_TEA);
+    if(app_worker_is_running() ? s_worker.count_mode != 0 || s_worker.tea != tea : !persist_exists(PERSIST_WAKEUP))
+      fail("quick launch did not start tea %d", tea);
+    
+    run(MAX_BREW_MS);
+    if(pbl_stack_count() > 0)
+      fail("app still open after the quick brew");
+    return;
+  }
+  
+  // A brew left running by the last launch is shown again, cancel it
+  if(pbl_stack_count() == 2) {
+    run(2000);
+    pbl_press(BUTTON_ID_SELECT);
+    run(1000);
+  }
+  if(pbl_stack_count() != 1)
+    fail("expected the menu only, %d windows shown", pbl_stack_count());
+
+  for(int brew = 0; brew <= CANCELLED_BREWS; brew++) {
+    if(!pbl_menu_select((s_launch + brew) % 9))
+      fail("menu not on top before brew %d", brew);
+    
+    // Back right after picking the tea, before the worker reports in
+    if(brew == CANCELLED_BREWS && closing() && (s_launch / CLOSE_EVERY) % 4 < 2) {
+      s_brews++;
+      return;
+    }
+    pbl_run(0);
+    worker_poll();
+    s_brews++;
+
+    if(brew < CANCELLED_BREWS) {
+      // Watch it, then cancel at a different point every time
+      run(2000);
+      pbl_press(BUTTON_ID_UP);
+      run(1000 + brew * 7000);
+      pbl_press(BUTTON_ID_SELECT);
+      run(1000);
+
+      if(pbl_stack_count() != 1)
+        fail("cancel did not return to the menu");
+
+      // Back at the menu, nothing may have piled up
+      if(s_menu_heap == 0)
+        s_menu_heap = heap_bytes_used();
+      else if(heap_bytes_used() != s_menu_heap)
+        fail("heap at the menu grew from %u to %u bytes", (unsigned) s_menu_heap, (unsigned) heap_bytes_used());
+    }
+    else if(closing()) {
+      // Leave the app while steeping, deinit runs with the countdown shown
+      run(5000);
+      return;
+    }
+    else {
+      // Steep, cool and done, the app closes by itself in the end
+      run(MAX_BREW_MS);
+      if(pbl_stack_count() > 0)
+        fail("app still open after the whole brew");
+    }
+  }
+}
+
+/********************/
+/*       MAIN       */
+/********************/
+
+int main(int argc, char **argv) {
+  int launches = argc > 1 ? atoi(argv[1]) : 2000;
+
+  pbl_on_worker_message(worker_hook);
+
+  for(s_launch = 0; s_launch < launches; s_launch++) {
+    // Every reminder setting, power profile and both brew paths
+    persist_write_int(PERSIST_READY, s_launch % 5);
+    persist_write_int(PERSIST_ANIMATE, 1);
+    pbl_set_battery((uint8_t[]){100, 30, 10}[s_launch % 3], false);
+    pbl_worker_set_available(s_launch % 2 == 1);
+
+    pbl_reset(s_launch % CLOSE_EVERY == QUICK_LAUNCH ? APP_LAUNCH_QUICK_LAUNCH : APP_LAUNCH_USER);
+    pebble_app_main();
+    size_t left = pbl_exit();
+
+    // A brew owned by the worker outlives the app
+    if(closing() && app_worker_is_running() && s_worker.count_mode != 0)
+      fail("the brew was lost when the app closed");
+    
+    if(!closing()) {
+      if(left != 0)
+        fail("%u bytes still allocated after the app closed itself", (unsigned) left);
+    }
+    else if(s_closed_heap == 0)
+      s_closed_heap = left;
+    else if(left != s_closed_heap)
+      fail("closing left %u bytes instead of %u", (unsigned) left, (unsigned) s_closed_heap);
+  }
+
+  PblHeapStats stats;
+  pbl_heap_stats(&stats);
+  printf("stress: %d launches, %d brews, %u windows shown, %u frames\n",
+         launches, s_brews, (unsigned) pbl_counters.window_pushes, (unsigned) pbl_counters.frames);
+  printf("stress: heap %u bytes, peak %u used, %u allocations\n",
+         (unsigned) stats.size, (unsigned) stats.peak, (unsigned) stats.allocations);
+  printf("stress: %u bytes used at the menu after every cancelled brew, %u left by closing while steeping, 0 otherwise\n",
+         (unsigned) s_menu_heap, (unsigned) s_closed_heap);
+  printf("stress: worst fragmentation %u.%u%% of the free heap, up to %u holes\n",
+         stats.worst_fragmentation / 10, stats.worst_fragmentation % 10, stats.worst_free_blocks);
+  return 0;
+}
\ No newline at end of file
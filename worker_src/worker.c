@@ -0,0 +1,160 @@
+#include <pebble_worker.h>
+#include "../src/keys.h"
+
+/********************/
+/*  STATIC DECLARE  */
+/********************/
+
+static void worker_message_handler(uint16_t, AppWorkerMessage*);
+static void worker_send_state();
+static void worker_schedule();
+static void worker_set_phase(uint8_t, uint16_t);
+static void worker_timer_handler(void*);
+
+/********************/
+/*    VARIABLES     */
+/********************/
+
+// Brew state, also kept in storage in case the worker is restarted
+typedef struct {
+  time_t end_time;     // End of the current phase
+  uint16_t duration;   // Length of the current phase in seconds
+  uint16_t cool_delay; // Length of the cooling phase, 0 to skip it
+  uint8_t count_mode;  // 0 steeping, 1 cooling, 2 done or idle
+  uint8_t tea;         // Index of the tea being brewed
+  bool alert;          // Phase changed and the app was not told yet
+} BrewState;
+
+static BrewState s_brew = {
+  .count_mode = WORKER_MODE_IDLE
+};
+
+// Fires once at the end of the current phase
+static AppTimer *s_phase_timer;
+
+/********************/
+/*      STATE       */
+/********************/
+
+// Report the brew state to the app, if it is running
+static void worker_send_state() {
+  time_t now = time(NULL);
+  AppWorkerMessage message = {
+    .data0 = s_brew.count_mode | (s_brew.tea << 4) | (s_brew.alert ? 0x100 : 0),
+    .data1 = s_brew.duration,
+    .data2 = s_brew.end_time > now ? s_brew.end_time - now : 0
+  };
+  app_worker_send_message(WORKER_BREW_STATE, &message);
+}
+
+// Sleep until the end of the current phase, if anything is counting down
+static void worker_schedule() {
+  if(s_phase_timer)
+    app_timer_cancel(s_phase_timer);
+  s_phase_timer = NULL;
+  
+  if(s_brew.count_mode < 2) {
+    time_t now = time(NULL);
+    uint32_t delay = s_brew.end_time > now ? (s_brew.end_time - now) * 1000 : 0;
+    s_phase_timer = app_timer_register(delay, worker_timer_handler, NULL);
+  }
+}
+
+// Move to a new phase
+static void worker_set_phase(uint8_t count_mode, uint16_t duration) {
+  s_brew.count_mode = count_mode;
+  s_brew.duration = duration;
+  s_brew.end_time = time(NULL) + duration;
+  worker_schedule();
+  
+  if(count_mode == WORKER_MODE_IDLE)
+    persist_delete(PERSIST_WORKER);
+  else
+    persist_write_data(PERSIST_WORKER, &s_brew, sizeof(s_brew));
+}
+
+/********************/
+/*      TIMERS      */
+/********************/
+
+static void worker_timer_handler(void *data) {
+  s_phase_timer = NULL;
+  
+  // Steeping is over, cool down if needed
+  s_brew.alert = true;
+  if(s_brew.count_mode == 0 && s_brew.cool_delay > 0)
+    worker_set_phase(1, s_brew.cool_delay);
+  else
+    worker_set_phase(2, 0);
+  
+  // Bring the app up to alert
+  worker_send_state();
+  worker_launch_app();
+}
+
+/********************/
+/*     MESSAGES     */
+/********************/
+
+static void worker_message_handler(uint16_t type, AppWorkerMessage *message) {
+  switch(type) {
+    case WORKER_BREW_START:
+      s_brew.tea = message->data0;
+      s_brew.cool_delay = message->data2;
+      s_brew.alert = false;
+      worker_set_phase(0, message->data1);
+      break;
+    case WORKER_BREW_CANCEL:
+      s_brew.alert = false;
+      worker_set_phase(WORKER_MODE_IDLE, 0);
+      break;
+    case WORKER_BREW_ACK:
+      s_brew.alert = false;
+      
+      // Nothing left to report once the tea is ready, the app then stops
+      // the worker
+      if(s_brew.count_mode == 2) {
+        worker_set_phase(WORKER_MODE_IDLE, 0);
+        break;
+      }
+      persist_write_data(PERSIST_WORKER, &s_brew, sizeof(s_brew));
+      return;
+  }
+  
+  worker_send_state();
+}
+
+/********************/
+/*  INIT & DEINIT   */
+/********************/
+
+static void worker_init() {
+  // Resume a brew from before the worker was restarted
+  if(persist_read_data(PERSIST_WORKER, &s_brew, sizeof(s_brew)) == sizeof(s_brew))
+    worker_schedule();
+  
+  app_worker_message_subscribe(worker_message_handler);
+  
+  // Start the brew the app launched the worker for, which reports it
+  AppWorkerMessage start;
+  if(persist_read_data(PERSIST_BREW_START, &start, sizeof(start)) == sizeof(start)) {
+    persist_delete(PERSIST_BREW_START);
+    worker_message_handler(WORKER_BREW_START, &start);
+    return;
+  }
+  
+  // Tell the app the worker is up
+  worker_send_state();
+}
+
+static void worker_deinit() {
+  if(s_phase_timer)
+    app_timer_cancel(s_phase_timer);
+  app_worker_message_unsubscribe();
+}
+
+int main(void) {
+  worker_init();
+  worker_event_loop();
+  worker_deinit();
+}
\ No newline at end of file